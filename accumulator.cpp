@@ -0,0 +1,264 @@
+module;
+
+#include <cassert>
+
+export module lab:accumulator;
+
+import :core;
+import :estimate;
+import :sample;
+import :serialization;
+
+export namespace lab
+{
+	namespace _detail
+	{
+		// Serialized layout, after the framing of binary_header_t with magic "LABACC\0\0":
+		//   uint8 kind (1: sample, 2: pair), uint8 sizeof(value_type), uint8 weighted, uint8 reserved = 0
+		//   uint64 size
+		//   value_type fields of the accumulator, in declaration order
+		struct accumulator_header_t
+		{
+			static constexpr std::array<char, 8> magic = { 'L', 'A', 'B', 'A', 'C', 'C', 0, 0 };
+			static constexpr std::uint16_t current_version = 1;
+
+			enum kind_t : std::uint8_t { sample = 1, pair = 2 };
+
+			kind_t kind;
+			std::uint8_t value_size;
+			bool weighted;
+			std::uint64_t size;
+
+			void write(std::ostream& output) const
+			{
+				binary_header_t::write_framing(output, magic, current_version);
+				for (std::uint8_t byte : { std::uint8_t(kind), value_size, std::uint8_t(weighted), std::uint8_t(0) })
+					binary_header_t::write_raw(output, byte);
+				binary_header_t::write_raw(output, size);
+			}
+
+			static accumulator_header_t read(std::istream& input)
+			{
+				binary_header_t::check_framing(input, "Input", "an accumulator state", magic, current_version);
+
+				accumulator_header_t header;
+				header.kind = kind_t(binary_header_t::read_raw<std::uint8_t>(input));
+				header.value_size = binary_header_t::read_raw<std::uint8_t>(input);
+				header.weighted = binary_header_t::read_raw<std::uint8_t>(input) != 0;
+				binary_header_t::read_raw<std::uint8_t>(input);
+				header.size = binary_header_t::read_raw<std::uint64_t>(input);
+				if (header.kind != sample && header.kind != pair)
+					throw std::runtime_error(std::format("Unknown accumulator kind {}.", int(header.kind)));
+				return header;
+			}
+		};
+	} // namespace _detail
+
+	// Sufficient statistics behind analyze_sample for a single variable. Partial accumulators
+	// over disjoint parts of a sample merge exactly (up to rounding) into the one of the whole
+	// sample, and round-trip through a compact versioned binary state.
+	template<typename T = double>
+	class sample_accumulator
+	{
+	public:
+		using value_type = T;
+		static_assert(std::floating_point<value_type>);
+	private:
+		using _header_t = _detail::accumulator_header_t;
+
+		bool _weighted;
+		std::uint64_t _size = 0;
+		// _m2 is the weighted sum of squared deviations from _mean
+		value_type _weight_sum = 0, _weight2_sum = 0, _mean = 0, _m2 = 0;
+
+		void _add(value_type x, value_type w)
+		{
+			++_size;
+			value_type delta = x - _mean;
+			_weight_sum += w;
+			_weight2_sum += w * w;
+			_mean += (w / _weight_sum) * delta;
+			_m2 += w * delta * (x - _mean);
+		}
+	public:
+		// weighted: samples are estimates weighted by their inverse variance, as analyze_sample does
+		explicit sample_accumulator(bool weighted = false)
+			: _weighted(weighted) {}
+
+		bool weighted() const { return _weighted; }
+		size_t size() const { return size_t(_size); }
+
+		void add(value_type x)
+		{
+			assert(!_weighted);
+			_add(x, 1);
+		}
+
+		void add(estimate_t<value_type> estimate)
+		{
+			assert(_weighted);
+			_add(estimate.value(), 1 / estimate.variance());
+		}
+
+		void merge(sample_accumulator const& other)
+		{
+			assert(_weighted == other._weighted);
+			if (other._size == 0)
+				return;
+			if (_size == 0)
+			{
+				*this = other;
+				return;
+			}
+			value_type
+				weight_sum = _weight_sum + other._weight_sum,
+				delta = other._mean - _mean;
+			_mean += delta * (other._weight_sum / weight_sum);
+			_m2 += other._m2 + delta * delta * (_weight_sum * other._weight_sum / weight_sum);
+			_weight_sum = weight_sum;
+			_weight2_sum += other._weight2_sum;
+			_size += other._size;
+		}
+
+		auto result() const
+		{
+			if (_weighted)
+				return _detail::analysis_result_t(size(), estimate_t(_mean, 1 / _weight_sum), _m2 / (_weight_sum - _weight2_sum / _weight_sum), _weight_sum, _weight2_sum);
+			value_type variance = _m2 / (size() - 1);
+			return _detail::analysis_result_t(size(), estimate_t(_mean, variance / size()), variance);
+		}
+
+		void write(std::ostream& output) const
+		{
+			_header_t{ _header_t::sample, std::uint8_t(sizeof(value_type)), _weighted, _size }.write(output);
+			for (value_type x : { _weight_sum, _weight2_sum, _mean, _m2 })
+				_detail::binary_header_t::write_raw(output, x);
+		}
+
+		// reads the state after its header
+		static sample_accumulator read(_detail::accumulator_header_t const& header, std::istream& input)
+		{
+			if (header.kind != _header_t::sample || header.value_size != sizeof(value_type))
+				throw std::runtime_error("Accumulator state does not hold a sample of this value type.");
+			sample_accumulator accumulator(header.weighted);
+			accumulator._size = header.size;
+			for (value_type* x : { &accumulator._weight_sum, &accumulator._weight2_sum, &accumulator._mean, &accumulator._m2 })
+				*x = _detail::binary_header_t::read_raw<value_type>(input);
+			return accumulator;
+		}
+	};
+
+	// Sufficient statistics behind analyze_sample/regression for (x, y) pairs: weights, means
+	// and co-moments, with the same merge and serialization support as sample_accumulator.
+	template<typename T = double>
+	class pair_accumulator
+	{
+	public:
+		using value_type = T;
+		static_assert(std::floating_point<value_type>);
+	private:
+		using _header_t = _detail::accumulator_header_t;
+
+		bool _weighted;
+		std::uint64_t _size = 0;
+		// _cxx, _cyy, _cxy are weighted sums of products of deviations from the means
+		value_type _weight_sum = 0, _weight2_sum = 0, _x_mean = 0, _y_mean = 0, _cxx = 0, _cyy = 0, _cxy = 0;
+
+		void _add(value_type x, value_type y, value_type w)
+		{
+			++_size;
+			value_type delta_x = x - _x_mean, delta_y = y - _y_mean;
+			_weight_sum += w;
+			_weight2_sum += w * w;
+			_x_mean += (w / _weight_sum) * delta_x;
+			_y_mean += (w / _weight_sum) * delta_y;
+			_cxx += w * delta_x * (x - _x_mean);
+			_cyy += w * delta_y * (y - _y_mean);
+			_cxy += w * delta_x * (y - _y_mean);
+		}
+	public:
+		// weighted: pairs of estimates weighted by the inverse variance of y, as analyze_sample does
+		explicit pair_accumulator(bool weighted = false)
+			: _weighted(weighted) {}
+
+		bool weighted() const { return _weighted; }
+		size_t size() const { return size_t(_size); }
+
+		void add(value_type x, value_type y)
+		{
+			assert(!_weighted);
+			_add(x, y, 1);
+		}
+
+		void add(estimate_t<value_type> x, estimate_t<value_type> y)
+		{
+			assert(_weighted);
+			_add(x.value(), y.value(), 1 / y.variance());
+		}
+
+		void merge(pair_accumulator const& other)
+		{
+			assert(_weighted == other._weighted);
+			if (other._size == 0)
+				return;
+			if (_size == 0)
+			{
+				*this = other;
+				return;
+			}
+			value_type
+				weight_sum = _weight_sum + other._weight_sum,
+				delta_x = other._x_mean - _x_mean,
+				delta_y = other._y_mean - _y_mean,
+				factor = _weight_sum * other._weight_sum / weight_sum;
+			_x_mean += delta_x * (other._weight_sum / weight_sum);
+			_y_mean += delta_y * (other._weight_sum / weight_sum);
+			_cxx += other._cxx + delta_x * delta_x * factor;
+			_cyy += other._cyy + delta_y * delta_y * factor;
+			_cxy += other._cxy + delta_x * delta_y * factor;
+			_weight_sum = weight_sum;
+			_weight2_sum += other._weight2_sum;
+			_size += other._size;
+		}
+
+		// can be passed to lab::regression
+		auto result() const
+		{
+			if (_weighted)
+			{
+				value_type factor = 1 / (_weight_sum - _weight2_sum / _weight_sum);
+				return _detail::pair_analysis_result_t(size(), _x_mean, _cxx * factor, _y_mean, _cyy * factor, _cxy * factor, _weight_sum, _weight2_sum);
+			}
+			value_type factor = value_type(1) / (size() - 1);
+			return _detail::pair_analysis_result_t(size(), _x_mean, _cxx * factor, _y_mean, _cyy * factor, _cxy * factor);
+		}
+
+		void write(std::ostream& output) const
+		{
+			_header_t{ _header_t::pair, std::uint8_t(sizeof(value_type)), _weighted, _size }.write(output);
+			for (value_type x : { _weight_sum, _weight2_sum, _x_mean, _y_mean, _cxx, _cyy, _cxy })
+				_detail::binary_header_t::write_raw(output, x);
+		}
+
+		// reads the state after its header
+		static pair_accumulator read(_detail::accumulator_header_t const& header, std::istream& input)
+		{
+			if (header.kind != _header_t::pair || header.value_size != sizeof(value_type))
+				throw std::runtime_error("Accumulator state does not hold a pair sample of this value type.");
+			pair_accumulator accumulator(header.weighted);
+			accumulator._size = header.size;
+			for (value_type* x : { &accumulator._weight_sum, &accumulator._weight2_sum, &accumulator._x_mean, &accumulator._y_mean, &accumulator._cxx, &accumulator._cyy, &accumulator._cxy })
+				*x = _detail::binary_header_t::read_raw<value_type>(input);
+			return accumulator;
+		}
+	};
+
+	template<typename T = double>
+	std::variant<sample_accumulator<T>, pair_accumulator<T>> read_accumulator(std::istream& input)
+	{
+		auto header = _detail::accumulator_header_t::read(input);
+		if (header.kind == _detail::accumulator_header_t::sample)
+			return sample_accumulator<T>::read(header, input);
+		return pair_accumulator<T>::read(header, input);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+module;
+
+#include <cassert>
+
+export module lab:calibration;
+
+import :core;
+import :estimate;
+import :estimate_vector;
+import :regression;
+
+export namespace lab
+{
+	// Straight line y = slope * x + intercept from a fit, applied forwards (x -> y) or inversely
+	// (y -> x) to whole arrays. Propagated variances include the slope/intercept covariance.
+	// The array kernels are branch-free loops over contiguous columns meant to be vectorized
+	// by the compiler; results are written as separate value and variance columns.
+	template<typename T = double>
+	class calibration_t
+	{
+	public:
+		using value_type = T;
+		static_assert(std::floating_point<value_type>);
+	private:
+		value_type _slope, _intercept, _slope_variance, _intercept_variance, _covariance;
+	public:
+		calibration_t(estimate_t<value_type> slope, estimate_t<value_type> intercept, value_type covariance)
+			: _slope(slope.value()), _intercept(intercept.value()), _slope_variance(slope.variance()), _intercept_variance(intercept.variance()), _covariance(covariance)
+		{}
+
+		// for a weighted least squares line cov(slope, intercept) = -<x> var(slope)
+		explicit calibration_t(_detail::regression_result_t<value_type> const& regression)
+			: calibration_t(regression.slope(), regression.intercept(), -regression.sample().x_mean() * regression.slope().variance())
+		{}
+
+		estimate_t<value_type> slope() const { return { _slope, _slope_variance }; }
+		estimate_t<value_type> intercept() const { return { _intercept, _intercept_variance }; }
+		value_type covariance() const { return _covariance; }
+
+		estimate_t<value_type> forward(estimate_t<value_type> x) const
+		{
+			value_type x_value = x.value(), x_variance = x.variance(), y, y_variance;
+			forward(std::span<value_type const>(&x_value, 1), std::span<value_type const>(&x_variance, 1), std::span(&y, 1), std::span(&y_variance, 1));
+			return { y, y_variance };
+		}
+
+		estimate_t<value_type> inverse(estimate_t<value_type> y) const
+		{
+			value_type y_value = y.value(), y_variance = y.variance(), x, x_variance;
+			inverse(std::span<value_type const>(&y_value, 1), std::span<value_type const>(&y_variance, 1), std::span(&x, 1), std::span(&x_variance, 1));
+			return { x, x_variance };
+		}
+
+		// y = slope * x + intercept,
+		// var(y) = x^2 var(slope) + 2 x cov + var(intercept) + slope^2 var(x)
+		void forward(std::span<value_type const> x, std::span<value_type const> x_variance, std::span<value_type> y, std::span<value_type> y_variance) const
+		{
+			assert(x_variance.size() == x.size() && y.size() == x.size() && y_variance.size() == x.size());
+
+			value_type
+				a = _slope, b = _intercept,
+				a2 = _slope * _slope, va = _slope_variance, vb = _intercept_variance, cov2 = 2 * _covariance;
+			value_type const* in = x.data(), * in_variance = x_variance.data();
+			value_type* out = y.data(), * out_variance = y_variance.data();
+			for (size_t i = 0, size = x.size(); i != size; ++i)
+			{
+				value_type xi = in[i];
+				out[i] = a * xi + b;
+				out_variance[i] = (xi * va + cov2) * xi + vb + a2 * in_variance[i];
+			}
+		}
+
+		// exact x
+		void forward(std::span<value_type const> x, std::span<value_type> y, std::span<value_type> y_variance) const
+		{
+			assert(y.size() == x.size() && y_variance.size() == x.size());
+
+			value_type a = _slope, b = _intercept, va = _slope_variance, vb = _intercept_variance, cov2 = 2 * _covariance;
+			value_type const* in = x.data();
+			value_type* out = y.data(), * out_variance = y_variance.data();
+			for (size_t i = 0, size = x.size(); i != size; ++i)
+			{
+				value_type xi = in[i];
+				out[i] = a * xi + b;
+				out_variance[i] = (xi * va + cov2) * xi + vb;
+			}
+		}
+
+		// x = (y - intercept) / slope,
+		// var(x) = (var(y) + var(intercept) + x^2 var(slope) + 2 x cov) / slope^2
+		void inverse(std::span<value_type const> y, std::span<value_type const> y_variance, std::span<value_type> x, std::span<value_type> x_variance) const
+		{
+			assert(y_variance.size() == y.size() && x.size() == y.size() && x_variance.size() == y.size());
+
+			value_type
+				inv_a = 1 / _slope, b = _intercept,
+				inv_a2 = inv_a * inv_a, va = _slope_variance, vb = _intercept_variance, cov2 = 2 * _covariance;
+			value_type const* in = y.data(), * in_variance = y_variance.data();
+			value_type* out = x.data(), * out_variance = x_variance.data();
+			for (size_t i = 0, size = y.size(); i != size; ++i)
+			{
+				value_type xi = (in[i] - b) * inv_a;
+				out[i] = xi;
+				out_variance[i] = ((xi * va + cov2) * xi + vb + in_variance[i]) * inv_a2;
+			}
+		}
+
+		// exact y
+		void inverse(std::span<value_type const> y, std::span<value_type> x, std::span<value_type> x_variance) const
+		{
+			assert(x.size() == y.size() && x_variance.size() == y.size());
+
+			value_type
+				inv_a = 1 / _slope, b = _intercept,
+				inv_a2 = inv_a * inv_a, va = _slope_variance, vb = _intercept_variance, cov2 = 2 * _covariance;
+			value_type const* in = y.data();
+			value_type* out = x.data(), * out_variance = x_variance.data();
+			for (size_t i = 0, size = y.size(); i != size; ++i)
+			{
+				value_type xi = (in[i] - b) * inv_a;
+				out[i] = xi;
+				out_variance[i] = ((xi * va + cov2) * xi + vb) * inv_a2;
+			}
+		}
+
+		estimate_vector<value_type> forward(estimate_vector<value_type> const& x) const
+		{
+			estimate_vector<value_type> y(x.size());
+			forward(x.values(), x.variances(), y.values(), y.variances());
+			return y;
+		}
+
+		estimate_vector<value_type> inverse(estimate_vector<value_type> const& y) const
+		{
+			estimate_vector<value_type> x(y.size());
+			inverse(y.values(), y.variances(), x.values(), x.variances());
+			return x;
+		}
+	};
+
+	template<typename T>
+	calibration_t(_detail::regression_result_t<T> const&) -> calibration_t<T>;
+}
\ No newline at end of file
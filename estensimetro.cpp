@@ -5,6 +5,25 @@ namespace stdv = std::views;
 namespace stdr = std::ranges;
 namespace stdf = std::filesystem;
 
+// counts global heap allocations for lab::allocation_scope
+void* operator new(std::size_t size)
+{
+	lab::global_allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
 struct __efn
 {
 	auto value_at(auto x0, auto d, auto k) const
@@ -20,154 +39,250 @@ struct __efn
 	}
 } inline constexpr e_fn;
 
-template<typename value_type = double>
-auto analyze(stdf::path extension_input_path, stdf::path compression_input_path, stdf::path extension_output_path, stdf::path compression_output_path,
-	lab::estimate_t<value_type> x0,
-	lab::estimate_t<value_type> d,
-	std::ostream& output = std::cout)
+// Whole file into text, which keeps its allocator.
+void read_file(stdf::path const& path, std::pmr::string& text)
 {
-	using estimate_t = lab::estimate_t<value_type>;
+	std::ifstream input(path, std::ios::binary);
+	if (!input)
+		throw std::runtime_error(std::format("Cannot open {} for reading.", path.string()));
+	input.exceptions(input.badbit);
 
-	std::vector<estimate_t> extensions, compressions;
-	for(auto [path, vec] : {std::tie(extension_input_path, extensions), std::tie(compression_input_path, compressions)})
-	{
-		std::ifstream input(path);
-		if (!input)
-			throw std::runtime_error(std::format("Cannot open {} for reading.", path.string()));
-		input.exceptions(input.badbit);
+	text.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
 
-		constexpr size_t chunk_size = 5;
-		constexpr value_type conv_factor = 1e-6;
+// Means of consecutive groups of readings, in m; the last group may be shorter.
+template<typename value_type>
+void parse_chunk_means(std::string_view text, std::pmr::vector<lab::estimate_t<value_type>>& means)
+{
+	constexpr size_t chunk_size = 5;
+	constexpr value_type conv_factor = 1e-6;
+
+	std::array<value_type, chunk_size> chunk;
+	size_t used = 0;
+	auto push_chunk = [&]
+	{
+		if (used != 0)
+			means.push_back(conv_factor * lab::analyze_sample(std::span(chunk.data(), used)).mean());
+		used = 0;
+	};
 
-		vec = std::vector<estimate_t>(std::from_range,
-			stdv::istream<value_type>(input) |
-			stdv::chunk(chunk_size) |
-			stdv::transform([conv_factor](auto x) {return conv_factor * lab::analyze_sample(x).mean(); }));
+	char const* first = text.data(), * last = text.data() + text.size();
+	while (true)
+	{
+		while (first != last && std::isspace(static_cast<unsigned char>(*first)))
+			++first;
+		if (first == last)
+			break;
+
+		value_type reading;
+		auto [ptr, ec] = std::from_chars(first, last, reading);
+		if (ec != std::errc())
+			throw std::runtime_error(std::format("Cannot parse a reading at offset {}.", first - text.data()));
+		first = ptr;
+
+		chunk[used++] = reading;
+		if (used == chunk_size)
+			push_chunk();
 	}
-	std::print(output,
-		"Extension sample (m):\n{:.6f}\n\n"
-		"Compression sample (m):\n{:.6f}\n\n",
-		extensions,
-		compressions);
+	push_chunk();
+}
 
+template<typename value_type>
+constexpr value_type force_conversion_factor = 4 * 9.806 / 1000;
 
-	std::vector<std::pair<estimate_t, estimate_t>> regression_ext_data, regression_compr_data;
+template<typename value_type>
+auto applied_forces()
+{
+	using estimate_t = lab::estimate_t<value_type>;
+	return stdv::iota(2, 13) | stdv::transform([](int i) {return force_conversion_factor<value_type> * estimate_t(i * 100, 0 /*!!!*/); });
+}
 
-	constexpr value_type force_conversion_factor = 4 * 9.806 / 1000;
+template<typename value_type>
+struct specimen_fit
+{
+	using estimate_t = lab::estimate_t<value_type>;
+	using data_t = std::pmr::vector<std::pair<estimate_t, estimate_t>>;
+	using regression_t = decltype(lab::regression(std::declval<data_t const&>()));
+
+	data_t extension_data, compression_data;
+	regression_t extension_regression, compression_regression;
+	estimate_t regression_k;
+	std::pmr::vector<value_type> iso_extension_ks, iso_compression_ks;
+	estimate_t iso_extension_k, iso_compression_k;
+	// E from every ISO k
+	std::pmr::vector<estimate_t> es;
+	lab::specimen_record_t<value_type> record;
+};
+
+// Numeric part of the analysis of a specimen: no I/O and every container from resource, so
+// that a large enough arena makes it free of global heap allocations.
+template<typename value_type>
+specimen_fit<value_type> fit_specimen(
+	std::pmr::vector<lab::estimate_t<value_type>> const& extensions,
+	std::pmr::vector<lab::estimate_t<value_type>> const& compressions,
+	lab::estimate_t<value_type> x0,
+	lab::estimate_t<value_type> d,
+	std::pmr::memory_resource* resource)
+{
+	using estimate_t = lab::estimate_t<value_type>;
 
-	auto forces = stdv::iota(2, 13) | stdv::transform([](int i) {return force_conversion_factor * estimate_t(i * 100, 0 /*!!!*/); });
+	auto forces = applied_forces<value_type>();
 	auto force_extension_pairs = stdv::zip(forces, extensions);
+	auto force_compression_pairs = stdv::zip(forces | stdv::reverse, compressions);
 	auto [init_force, init_length] = force_extension_pairs[0];
 
-	estimate_t extension_k, compression_k;
-	std::print(output, "Extension:\n");
+	std::pmr::vector<std::pair<estimate_t, estimate_t>> extension_data(resource), compression_data(resource);
+	for (auto [force, extension] : force_extension_pairs | stdv::drop(1))
+		extension_data.push_back({ force - init_force, extension - init_length });
+	for (auto [force, compression] : force_compression_pairs | stdv::take(10))
+		compression_data.push_back({ force - init_force, compression - init_length });
+	auto extension_regression = lab::regression(extension_data), compression_regression = lab::regression(compression_data);
+	auto regression_k = lab::analyze_sample(std::array{ extension_regression.slope(), compression_regression.slope() }).mean();
+
+	// ISO method: k from disjoint pairs of consecutive loads
+	std::pmr::vector<value_type> iso_extension_ks(resource), iso_compression_ks(resource);
+	std::pmr::vector<estimate_t> es(resource);
+	auto iso = [&](auto& pairs, std::pmr::vector<value_type>& ks)
 	{
-		for (auto [force, extension] : force_extension_pairs | stdv::drop(1))
+		for (auto [first, second] : pairs | stdv::adjacent<2> | stdv::stride(2))
 		{
-			auto delta_f = force - init_force, delta_x = extension - init_length;
-			regression_ext_data.push_back({ delta_f, delta_x });
-			std::print(output, "{:.0f} gp\t:\t{:.6f} m\n", delta_f / force_conversion_factor, delta_x);
+			estimate_t
+				deltax = std::get<1>(second) - std::get<1>(first),
+				deltaf = std::get<0>(second) - std::get<0>(first),
+				k = deltax / deltaf;
+			ks.push_back(k.value());
+			es.push_back(lab::estimate(e_fn, std::array{x0, d, k}));
 		}
-		auto regression_result = lab::regression(regression_ext_data);
-		extension_k = regression_result.slope();
-		std::print(output,
-			"\nAllungamento: Dx = ({:.8f}) * DF + {:.8f}\n",
-			regression_result.slope(), regression_result.intercept());
-
-		//                        vvvvv titolo
-		lab::plot_linear_regression("", "\\Delta F (N)", "\\Delta x (m)", regression_ext_data | stdv::transform([](auto x) {return std::pair(x.first, estimate_t(x.second.value(), x.second.variance() * 100)); }), regression_result, extension_output_path);
-	}
+		return lab::analyze_sample(ks).mean();
+	};
+	auto iso_extension_k = iso(force_extension_pairs, iso_extension_ks);
+	auto iso_compression_k = iso(force_compression_pairs, iso_compression_ks);
+	auto k = lab::analyze_sample(std::array{iso_extension_k, iso_compression_k}).mean();
 
-	std::print(output, "\nCompression:\n");
-	auto force_compression_pairs = stdv::zip(forces | stdv::reverse, compressions);
+	// check of Dx = K * DF with the ISO K over both series
+	auto all_data = stdv::join(std::array{ std::span(extension_data), std::span(compression_data) });
+	value_type x2 = 0;
+	size_t size = 0;
+	for (auto [df, dx] : all_data)
 	{
-		for (auto [force, compression] : force_compression_pairs | stdv::take(10))
-		{
-			auto delta_f = force - init_force, delta_x = compression - init_length;
-			regression_compr_data.push_back({ delta_f, delta_x });
-			std::print(output, "{:.0f} gp\t:\t{:.6f} m\n", delta_f / force_conversion_factor, delta_x);
-		}
-		auto regression_result = lab::regression(regression_compr_data);
-		compression_k = regression_result.slope();
-		std::print(output,
-			"\nAccorciamento: Dx = ({:.8f}) * DF + {:.8f}\n",
-			regression_result.slope(), regression_result.intercept());
-		//                        vvvvv titolo
-		lab::plot_linear_regression("",  "\\Delta F (N)", "\\Delta x (m)", regression_compr_data | stdv::transform([](auto x) {return std::pair(x.first, estimate_t(x.second.value(), x.second.variance() * 100)); }), regression_result, compression_output_path);
+		++size;
+		value_type term = dx.value() - k.value() * df.value();
+		x2 += term * term / dx.variance();
 	}
-	auto k_average = lab::analyze_sample(std::array{extension_k, compression_k});
-	std::print(output, "\nK = {:.8f} m/N\n", k_average.mean());
-
 
+	lab::specimen_record_t<value_type> record;
+	record.x0 = x0;
+	record.d = d;
+	record.k = k;
+	record.e = lab::estimate(e_fn, std::array{ x0, d, k });
+	record.correlation_coefficient = lab::regression(all_data).correlation_coefficient();
+	record.chi2 = x2;
+	record.points = std::uint32_t(size);
+
+	return {
+		std::move(extension_data), std::move(compression_data),
+		extension_regression, compression_regression, regression_k,
+		std::move(iso_extension_ks), std::move(iso_compression_ks), iso_extension_k, iso_compression_k,
+		std::move(es), record
+	};
+}
 
-	std::print(output, "\nMetodo ISO:\n");
-	std::vector<value_type> iso_ks;
-	std::vector<estimate_t> es;
-	for (auto [first, second] : force_extension_pairs | stdv::adjacent<2> | stdv::stride(2))
+// Printed report of a fitted specimen, plus samples and regressions in JSON Lines, one string
+// per direction. Everything is formatted into the strings, which keep their allocator: with
+// an arena behind them this makes no global heap allocation.
+template<typename value_type>
+void format_specimen(
+	specimen_fit<value_type> const& fit,
+	std::pmr::vector<lab::estimate_t<value_type>> const& extensions,
+	std::pmr::vector<lab::estimate_t<value_type>> const& compressions,
+	std::pmr::string& output, std::pmr::string& extension_data_output, std::pmr::string& compression_data_output)
+{
 	{
-		estimate_t
-			deltax = std::get<1>(second) - std::get<1>(first),
-			deltaf = std::get<0>(second) - std::get<0>(first),
-			k = deltax / deltaf;
-		iso_ks.push_back(k.value());
-		es.push_back(lab::estimate(e_fn, std::array{x0, d, k}));
-
-		std::print(output,
-			"{:.0f} gp\t:\t{:.6f} m\n"
-			"{:.0f} gp\t:\t{:.6f} m\n\n",
-			std::get<0>(first) / force_conversion_factor, std::get<1>(first),
-			std::get<0>(second) / force_conversion_factor, std::get<1>(second));
+		lab::result_writer<value_type> extension_data(extension_data_output, lab::output_format::json_lines);
+		extension_data.write(extensions);
+		extension_data.write(fit.extension_regression);
+
+		lab::result_writer<value_type> compression_data(compression_data_output, lab::output_format::json_lines);
+		compression_data.write(compressions);
+		compression_data.write(fit.compression_regression);
 	}
-	auto iso_ext = lab::analyze_sample(iso_ks);
-	std::print(output,
+
+	// the writer buffers, so it is flushed before every direct format_to into the same string
+	lab::result_writer<value_type> report(output, lab::output_format::text, 8);
+	auto out = std::back_inserter(output);
+
+	std::format_to(out, "Extension sample (m):\n");
+	report.write(extensions);
+	report.flush();
+	std::format_to(out, "\nCompression sample (m):\n");
+	report.write(compressions);
+	report.flush();
+
+	std::format_to(out, "\nExtension:\n");
+	for (auto [delta_f, delta_x] : fit.extension_data)
+		std::format_to(out, "{:.0f} gp\t:\t{:.6f} m\n", delta_f / force_conversion_factor<value_type>, delta_x);
+	std::format_to(out, "\nAllungamento: Dx = slope * DF + intercept\n");
+	report.write(fit.extension_regression);
+	report.flush();
+
+	std::format_to(out, "\nCompression:\n");
+	for (auto [delta_f, delta_x] : fit.compression_data)
+		std::format_to(out, "{:.0f} gp\t:\t{:.6f} m\n", delta_f / force_conversion_factor<value_type>, delta_x);
+	std::format_to(out, "\nAccorciamento: Dx = slope * DF + intercept\n");
+	report.write(fit.compression_regression);
+	report.flush();
+	std::format_to(out, "\nK = {:.8f} m/N\n", fit.regression_k);
+
+
+
+	std::format_to(out, "\nMetodo ISO:\n");
+	auto forces = applied_forces<value_type>();
+	auto print_pairs = [&](auto&& pairs)
+	{
+		for (auto [first, second] : pairs | stdv::adjacent<2> | stdv::stride(2))
+			std::format_to(out,
+				"{:.0f} gp\t:\t{:.6f} m\n"
+				"{:.0f} gp\t:\t{:.6f} m\n\n",
+				std::get<0>(first) / force_conversion_factor<value_type>, std::get<1>(first),
+				std::get<0>(second) / force_conversion_factor<value_type>, std::get<1>(second));
+	};
+	print_pairs(stdv::zip(forces, extensions));
+	std::format_to(out,
 		"Campione (m/N): {:.8f}\n"
 		"K_allungamento = {:.8f} m/N\n\n",
-		iso_ks,
-		iso_ext.mean());
+		fit.iso_extension_ks,
+		fit.iso_extension_k);
 
-	iso_ks.clear();
-
-	for (auto [first, second] : force_compression_pairs | stdv::adjacent<2> | stdv::stride(2))
-	{
-		estimate_t
-			deltax = std::get<1>(second) - std::get<1>(first),
-			deltaf = std::get<0>(second) - std::get<0>(first),
-			k = deltax / deltaf;
-		iso_ks.push_back(k.value());
-		es.push_back(lab::estimate(e_fn, std::array{x0, d, k}));
-		std::print(output,
-			"{:.0f} gp\t:\t{:.6f} m\n"
-			"{:.0f} gp\t:\t{:.6f} m\n\n",
-			std::get<0>(first) / force_conversion_factor, std::get<1>(first),
-			std::get<0>(second) / force_conversion_factor, std::get<1>(second));
-	}
-	auto iso_compr = lab::analyze_sample(iso_ks);
-	std::print(output,
+	print_pairs(stdv::zip(forces | stdv::reverse, compressions));
+	std::format_to(out,
 		"Campione (m/N): {:.8f}\n"
 		"K_accorciamento = {:.8f} m/N\n",
-		iso_ks,
-		iso_compr.mean());
+		fit.iso_compression_ks,
+		fit.iso_compression_k);
 
-	k_average = lab::analyze_sample(std::array{iso_ext.mean(), iso_compr.mean()});
-	std::print(output, "\nK = {:.8f} m/N\nE (con <K>) = {:.4} Pa\nE (con xi) = {:.4} Pa\n\n", k_average.mean(), lab::estimate(e_fn, std::array{x0, d, k_average.mean()}), lab::analyze_sample(es).mean());
+	std::format_to(out, "\nK = {:.8f} m/N\nE (con <K>) = {:.4} Pa\nE (con xi) = {:.4} Pa\n\n", fit.record.k, fit.record.e, lab::analyze_sample(fit.es).mean());
 
 
-	std::print(output,
+	std::format_to(out,
 		"Verifica di Dx=K*DF con K del metodo ISO\n"
 	);
+	std::format_to(out, "N = {}\tV = 1\tGDL = {}\tX^2 = {:.2f}\tX_0^2(95%) = {}\n", fit.record.points, fit.record.points - 1, fit.record.chi2, 28.87);
+	std::format_to(out, "Coefficiente di correlazione: {}\n", fit.record.correlation_coefficient);
+}
 
-	value_type x2 = 0;
-	size_t size = 0;
-	for (auto [df, dx] : stdv::join(std::array{ regression_ext_data, regression_compr_data }))
-	{
-		++size;
-		value_type term = dx.value() - k_average.mean().value() * df.value();
-		x2 += term * term / dx.variance();
-	}
-	std::print(output, "N = {}\tV = 1\tGDL = {}\tX^2 = {:.2f}\tX_0^2(95%) = {}\n", size, size - 1, x2, 28.87);
-	std::print(output, "Coefficiente di correlazione: {}\n", lab::regression(stdv::join(std::array{ regression_ext_data, regression_compr_data })).correlation_coefficient());
+// Plots of a fitted specimen.
+template<typename value_type>
+void plot_specimen(
+	specimen_fit<value_type> const& fit,
+	stdf::path extension_output_path, stdf::path compression_output_path,
+	std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+{
+	using estimate_t = lab::estimate_t<value_type>;
 
-	return k_average.mean();
+	//                        vvvvv titolo
+	lab::plot_linear_regression("", "\\Delta F (N)", "\\Delta x (m)", fit.extension_data | stdv::transform([](auto x) {return std::pair(x.first, estimate_t(x.second.value(), x.second.variance() * 100)); }), fit.extension_regression, extension_output_path, 4096, 2160, resource);
+	//                        vvvvv titolo
+	lab::plot_linear_regression("",  "\\Delta F (N)", "\\Delta x (m)", fit.compression_data | stdv::transform([](auto x) {return std::pair(x.first, estimate_t(x.second.value(), x.second.variance() * 100)); }), fit.compression_regression, compression_output_path, 4096, 2160, resource);
 }
 
 template<typename value_type = double>
@@ -238,46 +353,121 @@ int main()
 		obj{{300, 2 * 2}, {0.279, 0.279 * 0.279 / 10000}} // 19
 	} | stdv::transform([](obj o) {return obj(o.x0 * 0.001, o.d * 0.001); });
 
-	std::array<estimate_t, 17> ks =
+	// specimens analyzed in earlier sessions, with the logbook page their K comes from
+	struct earlier_result
 	{
-		estimate_t{lab::from_stddev, 0.000053970, 0.000000127}, // 2, GIO5
-		estimate_t{}, // 3*
-		estimate_t{}, // 4*
-		estimate_t{lab::from_stddev, 0.00007391884322, 0.000000683181686057084}, // 5 GIO2
-		estimate_t{lab::from_stddev, 6.3678E-05, 1.1399E-07}, // 6, GIO11
-		estimate_t{lab::from_stddev, 0.00005647, 0.0000001}, // 7, GIO7
-		estimate_t{lab::from_stddev, 4.470E-05, 5E-08}, // 8, GIO1
-		estimate_t{lab::from_stddev, 0.00004137526288, 0.0000002255753081}, // 9 GIO2
-		estimate_t{lab::from_stddev, 0.00003538422429, 0.0000002483229556}, // 10, GIO2
-		estimate_t{lab::from_stddev, 3.1678E-5, 1.32E-07}, // 11, GIO9
-		estimate_t{}, // 13*
-		estimate_t{}, // 14*
-		estimate_t{lab::from_stddev, 5.68E-05, 4E-07}, // 15, GIO1
-		estimate_t{}, // 16*
-		estimate_t{lab::from_stddev, 3.91E-5, 0.01E-5}, // 17, GIO8
-		estimate_t{lab::from_stddev, 3.31E-05, 1E-07}, // 18, GIO1
-		estimate_t{lab::from_stddev, 0.00002408, 0.0000002} // 19, GIO7
+		int id;
+		estimate_t k;
+		std::string_view source;
+	};
+	auto earlier_results = std::array{
+		earlier_result{2, {lab::from_stddev, 0.000053970, 0.000000127}, "GIO5"},
+		earlier_result{5, {lab::from_stddev, 0.00007391884322, 0.000000683181686057084}, "GIO2"},
+		earlier_result{6, {lab::from_stddev, 6.3678E-05, 1.1399E-07}, "GIO11"},
+		earlier_result{7, {lab::from_stddev, 0.00005647, 0.0000001}, "GIO7"},
+		earlier_result{8, {lab::from_stddev, 4.470E-05, 5E-08}, "GIO1"},
+		earlier_result{9, {lab::from_stddev, 0.00004137526288, 0.0000002255753081}, "GIO2"},
+		earlier_result{10, {lab::from_stddev, 0.00003538422429, 0.0000002483229556}, "GIO2"},
+		earlier_result{11, {lab::from_stddev, 3.1678E-5, 1.32E-07}, "GIO9"},
+		earlier_result{15, {lab::from_stddev, 5.68E-05, 4E-07}, "GIO1"},
+		earlier_result{17, {lab::from_stddev, 3.91E-5, 0.01E-5}, "GIO8"},
+		earlier_result{18, {lab::from_stddev, 3.31E-05, 1E-07}, "GIO1"},
+		earlier_result{19, {lab::from_stddev, 0.00002408, 0.0000002}, "GIO7"}
 	};
 
+	// every analysis is appended; queries take the latest record of each specimen. The values
+	// above stay authoritative: one that differs from the latest record of its specimen (a
+	// corrected logbook entry) is appended again, so an edit here is never silently ignored.
+	lab::results_store<value_type> store(base_path / "risultati");
+	for (auto [i, k, source] : earlier_results)
+	{
+		auto stored = store.latest(i);
+		if (stored && stored->k.value() == k.value() && stored->k.variance() == k.variance() && stored->source_view() == source)
+			continue;
+		auto o = objs[id_to_index(i)];
+		lab::specimen_record_t<value_type> record;
+		record.specimen = i;
+		record.x0 = o.x0;
+		record.d = o.d;
+		record.k = k;
+		record.e = lab::estimate(e_fn, std::array{ o.x0, o.d, k });
+		record.set_source(source);
+		store.append(record);
+	}
+	auto k_of = [&](int i) { return store.latest(i)->k; };
+
+	// per-specimen arena, reset between specimens; what does not fit in it comes from the default
+	// resource, which the allocation check below reports as an error
+	std::array<std::byte, 1 << 16> arena_buffer;
+	std::pmr::monotonic_buffer_resource arena(arena_buffer.data(), arena_buffer.size(), std::pmr::get_default_resource());
+
+	auto today = std::chrono::floor<std::chrono::days>(std::chrono::system_clock::now());
 	for (int i : {3, 4, 13, 14, 16})
 	{
-		estimate_t k = analyze(
-			base_path / std::format("{}al.txt", i),
-			base_path / std::format("{}ac.txt", i),
-			base_path / std::format("{}al.png", i),
-			base_path / std::format("{}ac.png", i),
-			objs[id_to_index(i)].x0,
-			objs[id_to_index(i)].d
-			, std::ofstream(base_path / std::format("{}out.txt", i))
-		);
-		ks[id_to_index(i)] = k;
+		arena.release();
+		auto o = objs[id_to_index(i)];
+
+		std::pmr::string extension_text(&arena), compression_text(&arena);
+		read_file(base_path / std::format("{}al.txt", i), extension_text);
+		read_file(base_path / std::format("{}ac.txt", i), compression_text);
+
+		// parsing, fit and formatting: everything but file I/O and plotting, which allocate on their own
+		lab::allocation_scope scope;
+		std::pmr::vector<estimate_t> extensions(&arena), compressions(&arena);
+		parse_chunk_means(extension_text, extensions);
+		parse_chunk_means(compression_text, compressions);
+		auto fit = fit_specimen(extensions, compressions, o.x0, o.d, &arena);
+		std::pmr::string report(&arena), extension_data(&arena), compression_data(&arena);
+		format_specimen(fit, extensions, compressions, report, extension_data, compression_data);
+		if (size_t allocations = scope.allocations(); allocations != 0)
+			throw std::runtime_error(std::format("Specimen {}: {} global heap allocations in the analysis, the arena is too small or something bypasses it.", i, allocations));
+
+		for (auto& [name, text] : { std::pair(std::format("{}out.txt", i), &report), std::pair(std::format("{}al.jsonl", i), &extension_data), std::pair(std::format("{}ac.jsonl", i), &compression_data) })
+		{
+			std::ofstream output(base_path / name);
+			output.exceptions(output.badbit | output.failbit);
+			output.write(text->data(), std::streamsize(text->size()));
+		}
+		plot_specimen(fit, base_path / std::format("{}al.png", i), base_path / std::format("{}ac.png", i), &arena);
+
+		// E from the extension and from the compression K share x0 and d: tracked through their
+		// sources, the correlation shows how much of the uncertainty comes from the geometry
+		lab::uncertainty_context<value_type> context;
+		auto x0 = context.independent("x0", o.x0), d = context.independent("d", o.d);
+		auto e_extension = lab::estimate(e_fn, std::array{ x0, d, context.independent("K allungamento", fit.iso_extension_k) });
+		auto e_compression = lab::estimate(e_fn, std::array{ x0, d, context.independent("K accorciamento", fit.iso_compression_k) });
+		std::print("Provino {}: E allungamento = {:.4} Pa, E accorciamento = {:.4} Pa, correlazione {:.3f}\n",
+			i, e_extension.to_estimate(), e_compression.to_estimate(), correlation(e_extension, e_compression));
+		// best linear unbiased combination of the two, with their covariance
+		auto e_combined = lab::combine(std::array{ e_extension, e_compression });
+		std::print("Provino {}: E (GLS) = {:.4} Pa, X^2 = {:.2f}\n", i, e_combined.mean(), e_combined.chi2());
+
+		// elastic limit: first load of the second segment of a two-segment fit of the extension
+		auto segmented = lab::segmented_regression(fit.extension_data, 2);
+		std::print("Provino {}: limite elastico a DF = {:.4f} N (pendenze {:.8f} e {:.8f} m/N)\n",
+			i, fit.extension_data[segmented.breakpoints()[0]].first, segmented.segments()[0].slope(), segmented.segments()[1].slope());
+
+		// robust counterpart of "E (con xi)" in the report: median and spread of the E of the ISO pairs
+		auto e_sketch = lab::sketch_sample(fit.es);
+		std::print("Provino {}: E (mediana ISO) = {:.4} Pa, MAD = {:.4} Pa\n", i, e_sketch.median(), e_sketch.median_absolute_deviation());
+
+		auto record = fit.record;
+		record.specimen = i;
+		record.set_day(today);
+		record.set_source(std::format("{0}al.txt {0}ac.txt", i));
+		store.append(record);
 	}
 
 	analyze_error(base_path / "4_s400.txt", base_path / "4_s1000.txt");
 	
 	{
 		std::print("\nL = 950mm (estensimetri 4~11)\n");
-		auto data = std::array{4, 5, 6, 7, 8, 9, 10, 11} | stdv::transform([&](int i) {return std::pair(4.0 / (lab::constants<value_type>::pi * objs[id_to_index(i)].d * objs[id_to_index(i)].d), ks[id_to_index(i)]); });
+		auto records = store.by_length(0.950 - 1e-6, 0.950 + 1e-6, lab::store_selection::latest);
+		lab::estimate_vector<value_type> ds(std::from_range, records | stdv::transform(&lab::specimen_record_t<value_type>::d));
+		lab::estimate_vector<value_type> ks(std::from_range, records | stdv::transform(&lab::specimen_record_t<value_type>::k));
+		// 1/S for all the specimens in one pass
+		lab::estimate_vector<value_type> inverse_sections = 4.0 / (cnst::pi * ds * ds);
+		auto data = stdv::zip(inverse_sections, ks);
 
 		auto regression_result = lab::regression(data);
 		lab::plot_linear_regression("Lunghezza a riposo costante", "1/S (m^{-2})", "K (mN^{-1})", data, regression_result, base_path / "constant_L.png");
@@ -286,25 +476,34 @@ int main()
 
 	{
 		std::print("D = 0.279mm (estensimetri 5, 14~19)\n");
-		auto data = std::array{5, 14, 15, 16, 17, 18, 19} | stdv::transform([&](int i) {return std::pair(objs[id_to_index(i)].x0, ks[id_to_index(i)]); });
+		auto records = store.by_diameter(0.279e-3 - 1e-9, 0.279e-3 + 1e-9, lab::store_selection::latest);
+		auto data = records | stdv::transform([](auto const& r) {return std::pair(r.x0, r.k); });
 		auto regression_result = lab::regression(data);
 		lab::plot_linear_regression("Sezione costante", "x_{0} (m)", "K (mN^{-1})", data, regression_result, base_path / "constant_D.png");
+
+		// x0 back from every K through the fitted line, as a check of the measured lengths
+		lab::calibration_t calibration(regression_result);
+		auto fitted_x0s = calibration.inverse(lab::estimate_vector<value_type>(std::from_range, records | stdv::transform(&lab::specimen_record_t<value_type>::k)));
+		for (auto [record, fitted_x0] : stdv::zip(records, fitted_x0s))
+			std::print("Provino {}: x0 = {:.4f} m, dalla retta {:.4f} m\n", record.specimen, record.x0, fitted_x0);
 	}
 
-	// do not include 3
-	auto es = std::array{4, 13, 14, 16, 5, 14, 15, 16, 17, 18, 19} |
-		stdv::transform([&](int i)
-			{
-				auto idx = id_to_index(i);
-				auto o = objs[idx];
-				return 4 * o.x0 / (cnst::pi * o.d * o.d * ks[idx]);
-			});
+	// do not include 3; E of all the specimens at once over x0, d and K columns
+	lab::estimate_vector<value_type> x0s, ds, ks;
+	for (int i : {4, 13, 14, 16, 5, 14, 15, 16, 17, 18, 19})
+	{
+		auto o = objs[id_to_index(i)];
+		x0s.push_back(o.x0);
+		ds.push_back(o.d);
+		ks.push_back(k_of(i));
+	}
+	auto es = lab::estimate(e_fn, std::array{ x0s, ds, ks });
 
 	int brass = id_to_index(3);
 	std::print(
 		"Modulo di Young acciaio (ISO): {}\n"
 		"Modulo di Young ottone: {}\n",
 		lab::analyze_sample(es).mean(),
-		4 * objs[brass].x0 / (cnst::pi * objs[brass].d * objs[brass].d * ks[brass])
+		lab::estimate(e_fn, std::array{ objs[brass].x0, objs[brass].d, k_of(3) })
 	);
-}
+}
\ No newline at end of file
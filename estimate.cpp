@@ -68,49 +68,49 @@ export namespace lab
 	// ratio defined below
 
 
-	template<typename T, typename U>
+	template<typename T, typename U> requires std::convertible_to<U, T>
 	estimate_t<T> operator+(estimate_t<T> e, U v)
 	{
 		return { e.value() + v, e.variance() };
 	}
 
-	template<typename T, typename U>
+	template<typename T, typename U> requires std::convertible_to<U, T>
 	estimate_t<T> operator+(U v, estimate_t<T> e)
 	{
 		return e + v;
 	}
 
-	template<typename T, typename U>
+	template<typename T, typename U> requires std::convertible_to<U, T>
 	estimate_t<T> operator-(estimate_t<T> e, U v)
 	{
 		return { e.value() - v, e.variance() };
 	}
 
-	template<typename T, typename U>
+	template<typename T, typename U> requires std::convertible_to<U, T>
 	estimate_t<T> operator-(U v, estimate_t<T> e)
 	{
 		return { v - e.value(), e.variance() };
 	}
 
-	template<typename T, typename U>
+	template<typename T, typename U> requires std::convertible_to<U, T>
 	estimate_t<T> operator*(estimate_t<T> e, U v)
 	{
 		return { e.value() * v, e.variance() * v * v };
 	}
 
-	template<typename T, typename U>
+	template<typename T, typename U> requires std::convertible_to<U, T>
 	estimate_t<T> operator*(U v, estimate_t<T> e)
 	{
 		return e * v;
 	}
 
-	template<typename T, typename U>
+	template<typename T, typename U> requires std::convertible_to<U, T>
 	estimate_t<T> operator/(estimate_t<T> e, U v)
 	{
 		return e * (T(1) / v);
 	}
 
-	template<typename T, typename U>
+	template<typename T, typename U> requires std::convertible_to<U, T>
 	estimate_t<T> operator/(U v, estimate_t<T> e)
 	{
 		return estimate_t<T>(v, 0) / e;
@@ -145,6 +145,16 @@ export namespace std
 	{
 		using type = T::value_type;
 	};
+
+	// (j, k) of the c-th pair j < k in the order (0,1), (0,2), ..., (1,2), ...
+	template<size_t N>
+	constexpr std::pair<size_t, size_t> _pair_index(size_t c)
+	{
+		size_t j = 0;
+		for (; c >= N - 1 - j; ++j)
+			c -= N - 1 - j;
+		return { j, j + 1 + c };
+	}
 }
 
 export namespace lab
@@ -193,6 +203,93 @@ export namespace lab
 		return estimate_t(value, variance);
 	}
 
+	// Batch version over columns: row i evaluates function at (values[0][i], ..., values[N-1][i])
+	// with variances variances[j][i] and, if given, covariances[c][i] for the N(N-1)/2 pairs
+	// j < k in the order (0,1), (0,2), ..., (1,2), ...; results go to result_values/result_variances.
+	// The row loop has no branches, compensation included, so it can be vectorized once
+	// function.value_at/derivative_at are inlined.
+	template<typename T, size_t N>
+	void estimate(
+		auto const& function,
+		std::array<std::span<T const>, N> const& values,
+		std::array<std::span<T const>, N> const& variances,
+		std::span<T> result_values,
+		std::span<T> result_variances,
+		std::span<std::span<T const> const> covariances = {}
+	)
+	{
+		static_assert(std::floating_point<T>);
+
+		size_t size = result_values.size();
+		assert(result_variances.size() == size);
+		assert(covariances.empty() || covariances.size() == N * (N - 1) / 2);
+
+		std::array<T const*, N> in, in_variance;
+		for (size_t j = 0; j != N; ++j)
+		{
+			assert(values[j].size() == size && variances[j].size() == size);
+			in[j] = values[j].data();
+			in_variance[j] = variances[j].data();
+		}
+		constexpr size_t pair_count = N * (N - 1) / 2;
+		std::array<T const*, pair_count> in_covariance{};
+		for (size_t c = 0; c != covariances.size(); ++c)
+		{
+			assert(covariances[c].size() == size);
+			in_covariance[c] = covariances[c].data();
+		}
+		auto rows = [&]<bool Correlated>(std::bool_constant<Correlated>)
+		{
+			// Rows go through local buffers, which cannot overlap the input columns: writing
+			// straight to result_values/result_variances would make the compiler check every
+			// input/output pair at run time before using the vector loop, and give up for N > 2.
+			constexpr size_t block_size = 256;
+			T block_values[block_size], block_variances[block_size];
+			for (size_t first = 0; first < size; first += block_size)
+			{
+				size_t count = std::min(block_size, size - first);
+				for (size_t b = 0; b != count; ++b)
+				{
+					size_t i = first + b;
+					auto [value, derivative] = [&]<size_t... In>(std::index_sequence<In...>)
+					{
+						return std::pair(function.value_at(in[In][i]...), function.derivative_at(in[In][i]...));
+					}(std::make_index_sequence<N>());
+
+					T variance = 0, compensation = 0;
+					auto compensated_add = [&](T new_term)
+					{
+						T t = variance + new_term;
+						// select the operands rather than the results, so no arithmetic is conditional
+						bool larger = std::abs(variance) >= std::abs(new_term);
+						T big = larger ? variance : new_term, small = larger ? new_term : variance;
+						compensation += (big - t) + small;
+						variance = t;
+					};
+					// expanded at compile time, so the only loop left is the one over rows
+					[&]<size_t... J>(std::index_sequence<J...>)
+					{
+						(compensated_add(derivative[J] * derivative[J] * in_variance[J][i]), ...);
+					}(std::make_index_sequence<N>());
+					if constexpr (Correlated)
+						[&]<size_t... C>(std::index_sequence<C...>)
+						{
+							(compensated_add(2 * derivative[_pair_index<N>(C).first] * derivative[_pair_index<N>(C).second] * in_covariance[C][i]), ...);
+						}(std::make_index_sequence<pair_count>());
+
+					block_values[b] = value;
+					block_variances[b] = variance + compensation;
+				}
+				stdr::copy_n(block_values, count, result_values.begin() + first);
+				stdr::copy_n(block_variances, count, result_variances.begin() + first);
+			}
+		};
+		if (covariances.empty())
+			rows(std::false_type());
+		else
+			rows(std::true_type());
+	}
+
 	
 	template<typename T>
 	estimate_t<T> operator/(estimate_t<T> lhs, estimate_t<T> rhs)
@@ -0,0 +1,380 @@
+module;
+
+#include <cassert>
+
+export module lab:estimate_vector;
+
+import :core;
+import :estimate;
+
+export namespace lab
+{
+	template<typename T>
+	class estimate_vector;
+
+	namespace _detail
+	{
+		// plain value/variance pair used inside expression evaluation, no invariant checks
+		template<typename T>
+		struct estimate_element_t
+		{
+			T value, variance;
+		};
+
+		template<typename E>
+		concept estimate_expression = requires { typename std::remove_cvref_t<E>::estimate_expression_tag; };
+
+		template<typename T>
+		struct vector_terminal
+		{
+			using estimate_expression_tag = void;
+			using value_type = T;
+			static constexpr bool is_broadcast = false;
+
+			T const* values;
+			T const* variances;
+			size_t count;
+
+			size_t size() const { return count; }
+			estimate_element_t<T> at(size_t i) const { return { values[i], variances[i] }; }
+		};
+
+		template<typename T>
+		struct broadcast_terminal
+		{
+			using estimate_expression_tag = void;
+			using value_type = T;
+			static constexpr bool is_broadcast = true;
+
+			estimate_element_t<T> element;
+
+			size_t size() const { return 0; }
+			estimate_element_t<T> at(size_t) const { return element; }
+		};
+
+		// same propagation formulas as the scalar estimate_t operators
+		struct add_op
+		{
+			template<typename T>
+			static estimate_element_t<T> apply(estimate_element_t<T> l, estimate_element_t<T> r)
+			{
+				return { l.value + r.value, l.variance + r.variance };
+			}
+		};
+
+		struct subtract_op
+		{
+			template<typename T>
+			static estimate_element_t<T> apply(estimate_element_t<T> l, estimate_element_t<T> r)
+			{
+				return { l.value - r.value, l.variance + r.variance };
+			}
+		};
+
+		struct multiply_op
+		{
+			template<typename T>
+			static estimate_element_t<T> apply(estimate_element_t<T> l, estimate_element_t<T> r)
+			{
+				T l_mean2 = l.value * l.value, r_mean2 = r.value * r.value;
+				return { l.value * r.value, l.variance * r.variance + l.variance * r_mean2 + l_mean2 * r.variance };
+			}
+		};
+
+		struct divide_op
+		{
+			template<typename T>
+			static estimate_element_t<T> apply(estimate_element_t<T> l, estimate_element_t<T> r)
+			{
+				T inv_r = 1 / r.value, quotient = l.value * inv_r;
+				return { quotient, (l.variance + quotient * quotient * r.variance) * inv_r * inv_r };
+			}
+		};
+
+		template<typename Op, typename L, typename R>
+		struct binary_expression
+		{
+			using estimate_expression_tag = void;
+			using value_type = std::common_type_t<typename L::value_type, typename R::value_type>;
+			static constexpr bool is_broadcast = L::is_broadcast && R::is_broadcast;
+
+			L lhs;
+			R rhs;
+
+			size_t size() const
+			{
+				if constexpr (L::is_broadcast)
+					return rhs.size();
+				else if constexpr (R::is_broadcast)
+					return lhs.size();
+				else
+				{
+					assert(lhs.size() == rhs.size());
+					return lhs.size();
+				}
+			}
+
+			estimate_element_t<value_type> at(size_t i) const
+			{
+				auto l = lhs.at(i);
+				auto r = rhs.at(i);
+				return Op::apply(
+					estimate_element_t<value_type>{ value_type(l.value), value_type(l.variance) },
+					estimate_element_t<value_type>{ value_type(r.value), value_type(r.variance) });
+			}
+		};
+
+		template<typename T>
+		inline constexpr bool is_estimate_vector = false;
+
+		template<typename T>
+		inline constexpr bool is_estimate_vector<estimate_vector<T>> = true;
+
+		template<typename T>
+		concept estimate_array_operand = estimate_expression<T> || is_estimate_vector<std::remove_cvref_t<T>>;
+
+		template<typename T>
+		concept estimate_scalar_operand = is_estimate<std::remove_cvref_t<T>> || std::is_arithmetic_v<std::remove_cvref_t<T>>;
+
+		template<typename T>
+		auto as_expression(T const& operand)
+		{
+			if constexpr (estimate_expression<T>)
+				return operand;
+			else if constexpr (is_estimate_vector<T>)
+				return vector_terminal<typename T::value_type>{ operand.values().data(), operand.variances().data(), operand.size() };
+			else if constexpr (is_estimate<T>)
+				return broadcast_terminal<typename T::value_type>{ { operand.value(), operand.variance() } };
+			else
+				return broadcast_terminal<T>{ { operand, T(0) } };
+		}
+
+		template<typename Op, typename L, typename R>
+		auto make_expression(L const& lhs, R const& rhs)
+		{
+			auto l = as_expression(lhs);
+			auto r = as_expression(rhs);
+			return binary_expression<Op, decltype(l), decltype(r)>{ l, r };
+		}
+	} // namespace _detail
+
+	// Estimates stored as separate value and variance columns. Arithmetic on whole vectors
+	// builds expression templates that are evaluated element-wise in a single loop when
+	// assigned, so (ext - init) / (f - f0) allocates only its result.
+	// Iterates as a range of estimate_t, so it can be passed to analyze_sample directly
+	// and zipped with another estimate_vector for regression.
+	template<typename T = double>
+	class estimate_vector
+	{
+	public:
+		using value_type = T;
+		static_assert(std::floating_point<value_type>);
+	private:
+		std::vector<value_type> _values, _variances;
+
+		template<typename Expression>
+		void _evaluate(Expression const& expression)
+		{
+			size_t size = expression.size();
+			_values.resize(size);
+			_variances.resize(size);
+			value_type* values = _values.data(), * variances = _variances.data();
+			for (size_t i = 0; i != size; ++i)
+			{
+				auto element = expression.at(i);
+				values[i] = element.value;
+				variances[i] = element.variance;
+			}
+		}
+	public:
+		class const_iterator
+		{
+			T const* _values = nullptr, * _variances = nullptr;
+		public:
+			using iterator_concept = std::random_access_iterator_tag;
+			using iterator_category = std::input_iterator_tag;
+			using value_type = estimate_t<T>;
+			using difference_type = std::ptrdiff_t;
+
+			const_iterator() = default;
+			const_iterator(T const* values, T const* variances)
+				: _values(values), _variances(variances) {}
+
+			value_type operator*() const { return { *_values, *_variances }; }
+			value_type operator[](difference_type n) const { return { _values[n], _variances[n] }; }
+
+			const_iterator& operator++() { ++_values; ++_variances; return *this; }
+			const_iterator operator++(int) { auto old = *this; ++*this; return old; }
+			const_iterator& operator--() { --_values; --_variances; return *this; }
+			const_iterator operator--(int) { auto old = *this; --*this; return old; }
+
+			const_iterator& operator+=(difference_type n) { _values += n; _variances += n; return *this; }
+			const_iterator& operator-=(difference_type n) { _values -= n; _variances -= n; return *this; }
+			friend const_iterator operator+(const_iterator it, difference_type n) { return it += n; }
+			friend const_iterator operator+(difference_type n, const_iterator it) { return it += n; }
+			friend const_iterator operator-(const_iterator it, difference_type n) { return it -= n; }
+			friend difference_type operator-(const_iterator const& lhs, const_iterator const& rhs) { return lhs._values - rhs._values; }
+
+			friend bool operator==(const_iterator const& lhs, const_iterator const& rhs) { return lhs._values == rhs._values; }
+			friend auto operator<=>(const_iterator const& lhs, const_iterator const& rhs) { return lhs._values <=> rhs._values; }
+		};
+
+		estimate_vector() = default;
+
+		explicit estimate_vector(size_t size, estimate_t<value_type> fill = estimate_t<value_type>(0, 0))
+			: _values(size, fill.value()), _variances(size, fill.variance()) {}
+
+		template<typename Range>
+		estimate_vector(std::from_range_t, Range&& estimates)
+		{
+			static_assert(stdr::range<Range>);
+
+			if constexpr (stdr::sized_range<Range>)
+				reserve(stdr::size(estimates));
+			for (estimate_t<value_type> estimate : estimates)
+				push_back(estimate);
+		}
+
+		template<_detail::estimate_expression Expression>
+		estimate_vector(Expression const& expression)
+		{
+			_evaluate(expression);
+		}
+
+		template<_detail::estimate_expression Expression>
+		estimate_vector& operator=(Expression const& expression)
+		{
+			// element i only reads index i of its operands, so assigning into an operand is safe
+			_evaluate(expression);
+			return *this;
+		}
+
+		size_t size() const { return _values.size(); }
+		bool empty() const { return _values.empty(); }
+
+		void reserve(size_t size)
+		{
+			_values.reserve(size);
+			_variances.reserve(size);
+		}
+
+		void clear()
+		{
+			_values.clear();
+			_variances.clear();
+		}
+
+		void push_back(estimate_t<value_type> estimate)
+		{
+			_values.push_back(estimate.value());
+			_variances.push_back(estimate.variance());
+		}
+
+		estimate_t<value_type> operator[](size_t i) const
+		{
+			assert(i < size());
+			return { _values[i], _variances[i] };
+		}
+
+		void set(size_t i, estimate_t<value_type> estimate)
+		{
+			assert(i < size());
+			_values[i] = estimate.value();
+			_variances[i] = estimate.variance();
+		}
+
+		std::span<value_type const> values() const { return _values; }
+		std::span<value_type> values() { return _values; }
+		std::span<value_type const> variances() const { return _variances; }
+		std::span<value_type> variances() { return _variances; }
+
+		const_iterator begin() const { return { _values.data(), _variances.data() }; }
+		const_iterator end() const { return { _values.data() + size(), _variances.data() + size() }; }
+
+		template<typename U> requires _detail::estimate_array_operand<U> || _detail::estimate_scalar_operand<U>
+		estimate_vector& operator+=(U const& rhs) { return *this = _detail::make_expression<_detail::add_op>(*this, rhs); }
+
+		template<typename U> requires _detail::estimate_array_operand<U> || _detail::estimate_scalar_operand<U>
+		estimate_vector& operator-=(U const& rhs) { return *this = _detail::make_expression<_detail::subtract_op>(*this, rhs); }
+
+		template<typename U> requires _detail::estimate_array_operand<U> || _detail::estimate_scalar_operand<U>
+		estimate_vector& operator*=(U const& rhs) { return *this = _detail::make_expression<_detail::multiply_op>(*this, rhs); }
+
+		template<typename U> requires _detail::estimate_array_operand<U> || _detail::estimate_scalar_operand<U>
+		estimate_vector& operator/=(U const& rhs) { return *this = _detail::make_expression<_detail::divide_op>(*this, rhs); }
+	};
+
+	template<typename Range>
+	estimate_vector(std::from_range_t, Range&&) -> estimate_vector<typename stdr::range_value_t<Range>::value_type>;
+
+	template<_detail::estimate_expression Expression>
+	estimate_vector(Expression const&) -> estimate_vector<typename Expression::value_type>;
+
+	template<_detail::estimate_expression Expression>
+	auto evaluate(Expression const& expression)
+	{
+		return estimate_vector<typename Expression::value_type>(expression);
+	}
+
+	template<typename L, typename R>
+		requires (_detail::estimate_array_operand<L> || _detail::estimate_array_operand<R>)
+			&& (_detail::estimate_array_operand<L> || _detail::estimate_scalar_operand<L>)
+			&& (_detail::estimate_array_operand<R> || _detail::estimate_scalar_operand<R>)
+	auto operator+(L const& lhs, R const& rhs)
+	{
+		return _detail::make_expression<_detail::add_op>(lhs, rhs);
+	}
+
+	template<typename L, typename R>
+		requires (_detail::estimate_array_operand<L> || _detail::estimate_array_operand<R>)
+			&& (_detail::estimate_array_operand<L> || _detail::estimate_scalar_operand<L>)
+			&& (_detail::estimate_array_operand<R> || _detail::estimate_scalar_operand<R>)
+	auto operator-(L const& lhs, R const& rhs)
+	{
+		return _detail::make_expression<_detail::subtract_op>(lhs, rhs);
+	}
+
+	template<typename L, typename R>
+		requires (_detail::estimate_array_operand<L> || _detail::estimate_array_operand<R>)
+			&& (_detail::estimate_array_operand<L> || _detail::estimate_scalar_operand<L>)
+			&& (_detail::estimate_array_operand<R> || _detail::estimate_scalar_operand<R>)
+	auto operator*(L const& lhs, R const& rhs)
+	{
+		return _detail::make_expression<_detail::multiply_op>(lhs, rhs);
+	}
+
+	template<typename L, typename R>
+		requires (_detail::estimate_array_operand<L> || _detail::estimate_array_operand<R>)
+			&& (_detail::estimate_array_operand<L> || _detail::estimate_scalar_operand<L>)
+			&& (_detail::estimate_array_operand<R> || _detail::estimate_scalar_operand<R>)
+	auto operator/(L const& lhs, R const& rhs)
+	{
+		return _detail::make_expression<_detail::divide_op>(lhs, rhs);
+	}
+
+	// lab::estimate row by row over estimate_vector columns of equal size, independent arguments
+	template<typename T, size_t N>
+	estimate_vector<T> estimate(auto const& function, std::array<estimate_vector<T>, N> const& arguments)
+	{
+		static_assert(N != 0);
+
+		std::array<std::span<T const>, N> values, variances;
+		for (size_t j = 0; j != N; ++j)
+		{
+			values[j] = arguments[j].values();
+			variances[j] = arguments[j].variances();
+		}
+		estimate_vector<T> result(arguments[0].size());
+		lab::estimate(function, values, variances, result.values(), result.variances());
+		return result;
+	}
+
+	namespace _detail
+	{
+		// expression nodes live here, so argument-dependent lookup has to find the operators too
+		using lab::operator+;
+		using lab::operator-;
+		using lab::operator*;
+		using lab::operator/;
+	}
+}
\ No newline at end of file
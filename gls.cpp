@@ -0,0 +1,161 @@
+module;
+
+#include <cassert>
+
+export module lab:gls;
+
+import :core;
+import :estimate;
+import :tracked;
+
+export namespace lab
+{
+	namespace _detail
+	{
+		template<typename ValueType>
+		struct combination_result_t
+		{
+			using value_type = ValueType;
+		private:
+			size_t _size;
+			estimate_t<value_type> _mean;
+			value_type _chi2;
+		public:
+			combination_result_t(size_t size, estimate_t<value_type> mean, value_type chi2)
+				: _size(size), _mean(mean), _chi2(chi2) {}
+
+			size_t size() const { return _size; }
+			estimate_t<value_type> mean() const { return _mean; }
+			// (x - mean)^T C^-1 (x - mean), chi-square distributed with size() - 1 degrees of freedom for consistent inputs
+			value_type chi2() const { return _chi2; }
+			size_t degrees_of_freedom() const { return _size - 1; }
+		};
+
+		// sum of a[i] * b[i] with independent partial sums, so the loop can be vectorized
+		template<typename T>
+		T dot(T const* a, T const* b, size_t size)
+		{
+			T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+			size_t i = 0;
+			for (; i + 4 <= size; i += 4)
+			{
+				s0 += a[i] * b[i];
+				s1 += a[i + 1] * b[i + 1];
+				s2 += a[i + 2] * b[i + 2];
+				s3 += a[i + 3] * b[i + 3];
+			}
+			for (; i != size; ++i)
+				s0 += a[i] * b[i];
+			return (s0 + s1) + (s2 + s3);
+		}
+
+		// In place blocked Cholesky factorization C = L L^T of a row-major n x n symmetric
+		// positive definite matrix; only the lower triangle is read and replaced by L.
+		// Every inner loop is a dot product of two contiguous row segments.
+		template<typename T>
+		void cholesky(std::span<T> matrix, size_t n, size_t block_size = 64)
+		{
+			assert(matrix.size() == n * n);
+
+			auto a = [&](size_t i, size_t j) -> T& { return matrix[i * n + j]; };
+			for (size_t k = 0; k < n; k += block_size)
+			{
+				size_t end = std::min(k + block_size, n);
+
+				// diagonal block, unblocked
+				for (size_t j = k; j != end; ++j)
+				{
+					T diagonal = a(j, j) - dot(&a(j, k), &a(j, k), j - k);
+					if (!(diagonal > 0))
+						throw std::runtime_error(std::format("Covariance matrix is not positive definite (pivot {} is {}).", j, diagonal));
+					a(j, j) = std::sqrt(diagonal);
+					for (size_t i = j + 1; i != end; ++i)
+						a(i, j) = (a(i, j) - dot(&a(i, k), &a(j, k), j - k)) / a(j, j);
+				}
+
+				// panel below it: L[i, k:end] = C[i, k:end] L[k:end, k:end]^-T
+				for (size_t i = end; i != n; ++i)
+					for (size_t j = k; j != end; ++j)
+						a(i, j) = (a(i, j) - dot(&a(i, k), &a(j, k), j - k)) / a(j, j);
+
+				// trailing submatrix: C[i, j] -= L[i, k:end] . L[j, k:end]
+				for (size_t i = end; i != n; ++i)
+					for (size_t j = end; j <= i; ++j)
+						a(i, j) -= dot(&a(i, k), &a(j, k), end - k);
+			}
+		}
+
+		// solves L x = b in place for a factor computed by cholesky
+		template<typename T>
+		void forward_substitution(std::span<T const> factor, size_t n, std::span<T> b)
+		{
+			assert(factor.size() == n * n && b.size() == n);
+
+			for (size_t i = 0; i != n; ++i)
+				b[i] = (b[i] - dot(&factor[i * n], b.data(), i)) / factor[i * n + i];
+		}
+	} // namespace _detail
+
+	// Best linear unbiased (generalized least squares) estimate of a quantity measured
+	// several times with correlated errors: mean = 1^T C^-1 x / 1^T C^-1 1 with variance
+	// 1 / 1^T C^-1 1, where C is the row-major covariance matrix of the measurements.
+	// Through the Cholesky factor L only two triangular solves are needed: with L z = 1 and
+	// L w = x, 1^T C^-1 1 = z.z, 1^T C^-1 x = z.w and x^T C^-1 x = w.w.
+	template<typename Values, typename Covariance> requires std::floating_point<stdr::range_value_t<Values>>
+	auto combine(Values&& values, Covariance&& covariance)
+	{
+		static_assert(stdr::range<Covariance>);
+
+		using value_type = stdr::range_value_t<Values>;
+
+		std::vector<value_type> factor(std::from_range, covariance), w(std::from_range, values);
+		size_t size = w.size();
+		assert(size != 0 && factor.size() == size * size);
+
+		std::vector<value_type> z(size, value_type(1));
+		_detail::cholesky(std::span(factor), size);
+		_detail::forward_substitution(std::span<value_type const>(factor), size, std::span(z));
+		_detail::forward_substitution(std::span<value_type const>(factor), size, std::span(w));
+
+		value_type
+			zz = _detail::dot(z.data(), z.data(), size),
+			zw = _detail::dot(z.data(), w.data(), size),
+			ww = _detail::dot(w.data(), w.data(), size),
+			mean = zw / zz;
+		return _detail::combination_result_t<value_type>(size, estimate_t<value_type>(mean, 1 / zz), std::max(ww - zw * mean, value_type(0)));
+	}
+
+	// covariance taken from the sources shared by the estimates
+	template<typename Estimates> requires is_tracked_estimate<stdr::range_value_t<Estimates>>
+	auto combine(Estimates&& estimates)
+	{
+		auto values = estimates | stdv::transform([](auto const& e) { return e.value(); });
+		return combine(values, covariance_matrix(estimates));
+	}
+
+	// estimates with correlations given as a row-major matrix of correlation coefficients
+	template<typename Estimates, typename Correlation> requires is_estimate<stdr::range_value_t<Estimates>>
+	auto combine(Estimates&& estimates, Correlation&& correlation)
+	{
+		static_assert(stdr::range<Correlation>);
+
+		using value_type = stdr::range_value_t<Estimates>::value_type;
+
+		std::vector<value_type> values, stddevs;
+		for (auto e : estimates)
+		{
+			values.push_back(e.value());
+			stddevs.push_back(e.stddev());
+		}
+		size_t size = values.size(), n = 0;
+		std::vector<value_type> covariance;
+		covariance.reserve(size * size);
+		for (value_type c : correlation)
+		{
+			covariance.push_back(c * stddevs[n / size] * stddevs[n % size]);
+			++n;
+		}
+		assert(covariance.size() == size * size);
+		return combine(values, covariance);
+	}
+}
\ No newline at end of file
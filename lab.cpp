@@ -2,7 +2,18 @@ export module lab;
 
 export import :core;
 export import :constants;
+export import :memory;
+export import :serialization;
 export import :sample;
+export import :accumulator;
+export import :quantile;
 export import :estimate;
+export import :estimate_vector;
+export import :tracked;
+export import :gls;
 export import :regression;
+export import :segmented_regression;
+export import :calibration;
+export import :results_store;
+export import :output;
 export import :root;
\ No newline at end of file
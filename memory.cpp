@@ -0,0 +1,21 @@
+export module lab:memory;
+
+import :core;
+
+export namespace lab
+{
+	// Number of calls to the global operator new, incremented by the replacement allocation
+	// functions of programs that define them (estensimetro.cpp does); stays 0 otherwise.
+	inline constinit std::atomic<size_t> global_allocation_count = 0;
+
+	// Global heap allocations made since construction.
+	class allocation_scope
+	{
+		size_t _start;
+	public:
+		allocation_scope()
+			: _start(global_allocation_count.load(std::memory_order_relaxed)) {}
+
+		size_t allocations() const { return global_allocation_count.load(std::memory_order_relaxed) - _start; }
+	};
+}
\ No newline at end of file
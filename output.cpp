@@ -0,0 +1,286 @@
+module;
+
+#include <cassert>
+
+export module lab:output;
+
+import :core;
+import :estimate;
+import :regression;
+
+export namespace lab
+{
+	enum class output_format
+	{
+		text,		// "value +- stddev", same rendering as std::formatter<estimate_t>
+		csv,		// a single header line, then one row per record with a kind column; fields of the other kind are empty
+		json_lines,	// one JSON object per line with a "kind" field, NaN and infinities written as null
+		binary		// packed native-endian records, each after a one byte kind, see result_writer::write
+	};
+
+	// Bulk writer for estimates and regression results: numbers go through std::to_chars
+	// into a large reusable buffer that is handed to the stream only when full.
+	// Writing to a std::pmr::string takes the buffer from the string's resource instead,
+	// so that formatting into an arena makes no global heap allocation.
+	template<typename T = double>
+	class result_writer
+	{
+	public:
+		using value_type = T;
+		static_assert(std::floating_point<value_type>);
+
+		static constexpr size_t default_buffer_size = size_t(1) << 20;
+	private:
+		static constexpr size_t _max_record_size = 1024;
+
+		enum class _record_kind : std::uint8_t { estimate = 1, regression = 2 };
+
+		static constexpr std::string_view _csv_header = "kind,index,value,variance,slope,slope_variance,intercept,intercept_variance,correlation,size\n";
+
+		// exactly one of the two sinks is set
+		std::ostream* _stream = nullptr;
+		std::pmr::string* _string = nullptr;
+		output_format _format;
+		int _precision;
+		std::pmr::vector<char> _buffer;
+		size_t _used = 0;
+		// records of each kind are numbered separately
+		size_t _estimate_index = 0, _regression_index = 0;
+		bool _header_written = false;
+
+		void _write(char const* data, size_t size)
+		{
+			if (_stream)
+				_stream->write(data, std::streamsize(size));
+			else
+				_string->append(data, size);
+		}
+
+		void _reserve(size_t size)
+		{
+			if (_buffer.size() - _used < size)
+				flush();
+		}
+
+		void _put(std::string_view text)
+		{
+			_reserve(text.size());
+			if (_buffer.size() < text.size())
+			{
+				_write(text.data(), text.size());
+				return;
+			}
+			stdr::copy(text, _buffer.data() + _used);
+			_used += text.size();
+		}
+
+		void _put(char c)
+		{
+			_reserve(1);
+			_buffer[_used++] = c;
+		}
+
+		template<typename U>
+		void _put_number(U number, bool fixed = false)
+		{
+			auto try_put = [&]
+			{
+				char* first = _buffer.data() + _used, * last = _buffer.data() + _buffer.size();
+				std::to_chars_result result;
+				if constexpr (std::floating_point<U>)
+					result = fixed ? std::to_chars(first, last, number, std::chars_format::fixed, _precision) : std::to_chars(first, last, number);
+				else
+					result = std::to_chars(first, last, number);
+				if (result.ec != std::errc())
+					return false;
+				_used = result.ptr - _buffer.data();
+				return true;
+			};
+			if (try_put())
+				return;
+			flush();
+			if (!try_put())
+				throw std::runtime_error(std::format("Cannot format {} in a {} byte buffer.", number, _buffer.size()));
+		}
+
+		void _put_json_number(value_type number)
+		{
+			if (std::isfinite(number))
+				_put_number(number);
+			else
+				_put("null");
+		}
+
+		template<typename U>
+		void _put_binary(U value)
+		{
+			static_assert(std::is_trivially_copyable_v<U>);
+			_reserve(sizeof(U));
+			std::memcpy(_buffer.data() + _used, &value, sizeof(U));
+			_used += sizeof(U);
+		}
+
+		void _begin_record(_record_kind kind)
+		{
+			_reserve(_max_record_size);
+			if (_format == output_format::csv && !_header_written)
+			{
+				_put(_csv_header);
+				_header_written = true;
+			}
+			if (_format == output_format::binary)
+				_put_binary(kind);
+		}
+	public:
+		// precision < 0 writes the shortest representation that round-trips,
+		// otherwise fixed notation with that many digits (text format only)
+		explicit result_writer(std::ostream& output, output_format format = output_format::text, int precision = -1, size_t buffer_size = default_buffer_size)
+			: _stream(&output), _format(format), _precision(precision), _buffer(std::max(buffer_size, _max_record_size))
+		{}
+
+		// appends to output; a small buffer suffices since appending to a string is cheap
+		explicit result_writer(std::pmr::string& output, output_format format = output_format::text, int precision = -1, size_t buffer_size = _max_record_size)
+			: _string(&output), _format(format), _precision(precision), _buffer(std::max(buffer_size, _max_record_size), output.get_allocator())
+		{}
+
+		result_writer(result_writer const&) = delete;
+		result_writer& operator=(result_writer const&) = delete;
+
+		~result_writer()
+		{
+			flush();
+		}
+
+		output_format format() const { return _format; }
+
+		// binary record: std::uint8_t 1, value_type value, value_type variance
+		void write(estimate_t<value_type> estimate)
+		{
+			_begin_record(_record_kind::estimate);
+			switch (_format)
+			{
+			case output_format::text:
+				_put_number(estimate.value(), _precision >= 0);
+				_put(" +- ");
+				_put_number(estimate.stddev(), _precision >= 0);
+				_put('\n');
+				break;
+			case output_format::csv:
+				_put("estimate,");
+				_put_number(_estimate_index);
+				_put(',');
+				_put_number(estimate.value());
+				_put(',');
+				_put_number(estimate.variance());
+				_put(",,,,,,\n");
+				break;
+			case output_format::json_lines:
+				_put("{\"kind\":\"estimate\",\"index\":");
+				_put_number(_estimate_index);
+				_put(",\"value\":");
+				_put_json_number(estimate.value());
+				_put(",\"variance\":");
+				_put_json_number(estimate.variance());
+				_put("}\n");
+				break;
+			case output_format::binary:
+				_put_binary(estimate.value());
+				_put_binary(estimate.variance());
+				break;
+			}
+			++_estimate_index;
+		}
+
+		template<typename Range> requires stdr::range<Range>
+		void write(Range&& estimates)
+		{
+			static_assert(std::same_as<stdr::range_value_t<Range>, estimate_t<value_type>>);
+
+			for (auto estimate : estimates)
+				write(estimate);
+		}
+
+		// binary record: std::uint8_t 2, value_type slope, slope variance, intercept, intercept variance,
+		// correlation coefficient, std::uint64_t size
+		void write(_detail::regression_result_t<value_type> const& regression)
+		{
+			_begin_record(_record_kind::regression);
+			auto slope = regression.slope(), intercept = regression.intercept();
+			value_type correlation = regression.correlation_coefficient();
+			size_t size = regression.sample().size();
+			switch (_format)
+			{
+			case output_format::text:
+				_put("slope = ");
+				_put_number(slope.value(), _precision >= 0);
+				_put(" +- ");
+				_put_number(slope.stddev(), _precision >= 0);
+				_put("\nintercept = ");
+				_put_number(intercept.value(), _precision >= 0);
+				_put(" +- ");
+				_put_number(intercept.stddev(), _precision >= 0);
+				_put("\nr = ");
+				_put_number(correlation);
+				_put("\nN = ");
+				_put_number(size);
+				_put('\n');
+				break;
+			case output_format::csv:
+				_put("regression,");
+				_put_number(_regression_index);
+				_put(",,,");
+				for (value_type x : { slope.value(), slope.variance(), intercept.value(), intercept.variance(), correlation })
+				{
+					_put_number(x);
+					_put(',');
+				}
+				_put_number(size);
+				_put('\n');
+				break;
+			case output_format::json_lines:
+				_put("{\"kind\":\"regression\",\"index\":");
+				_put_number(_regression_index);
+				_put(",\"slope\":");
+				_put_json_number(slope.value());
+				_put(",\"slope_variance\":");
+				_put_json_number(slope.variance());
+				_put(",\"intercept\":");
+				_put_json_number(intercept.value());
+				_put(",\"intercept_variance\":");
+				_put_json_number(intercept.variance());
+				_put(",\"correlation\":");
+				_put_json_number(correlation);
+				_put(",\"size\":");
+				_put_number(size);
+				_put("}\n");
+				break;
+			case output_format::binary:
+				for (value_type x : { slope.value(), slope.variance(), intercept.value(), intercept.variance(), correlation })
+					_put_binary(x);
+				_put_binary(std::uint64_t(size));
+				break;
+			}
+			++_regression_index;
+		}
+
+		void flush()
+		{
+			assert(_used <= _buffer.size());
+			if (_used == 0)
+				return;
+			_write(_buffer.data(), _used);
+			_used = 0;
+		}
+	};
+
+	template<typename Range>
+	void write_results(std::ostream& output, output_format format, Range&& results, int precision = -1)
+	{
+		static_assert(stdr::range<Range>);
+
+		using value_type = stdr::range_value_t<Range>::value_type;
+
+		result_writer<value_type> writer(output, format, precision);
+		writer.write(std::forward<Range>(results));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,223 @@
+module;
+
+#include <cassert>
+
+export module lab:quantile;
+
+import :core;
+import :estimate;
+
+export namespace lab
+{
+	// KLL quantile sketch (Karnin, Lang, Liberty 2016): bounded memory, O(k) items, mergeable.
+	// Level h is a compactor of items of weight 2^h; a full level is sorted and every other item,
+	// starting from a random offset, is promoted to the next one. An insertion that fills no level
+	// is O(1); the compactions cost O(log k) per item amortized (sorting a full level of O(k)
+	// items every O(k) insertions), independently of the number of items. Up to about 3k items
+	// the sketch is exact.
+	//
+	// Error: the rank of the returned quantile differs from the requested one by at most
+	// normalized_rank_error() * size() with 99% confidence; for k = 200 this is about 1.3%
+	// for a single quantile and 1.7% simultaneously for all of them (empirical fit of the
+	// Apache DataSketches KLL sketch, which uses the same compaction scheme).
+	template<typename T = double>
+	class quantile_sketch
+	{
+	public:
+		using value_type = T;
+		static_assert(std::floating_point<value_type>);
+
+		static constexpr size_t default_k = 200;
+	private:
+		static constexpr size_t _min_capacity = 8;
+
+		size_t _k;
+		std::uint64_t _size = 0;
+		value_type _min = std::numeric_limits<value_type>::infinity(), _max = -_min;
+		std::vector<std::vector<value_type>> _levels;
+		std::minstd_rand _random;
+		// capacities depend only on the number of levels: recomputed when it changes, so that
+		// an insertion only compares two counters
+		std::vector<size_t> _capacities;
+		size_t _total_capacity = 0, _retained = 0;
+
+		void _resize_levels(size_t count)
+		{
+			_levels.resize(count);
+			_capacities.resize(count);
+			_total_capacity = 0;
+			for (size_t h = 0; h != count; ++h)
+			{
+				auto depth = int(count - 1 - h);
+				_capacities[h] = std::max(_min_capacity, size_t(std::ceil(_k * std::pow(value_type(2) / 3, depth))));
+				_total_capacity += _capacities[h];
+			}
+		}
+
+		void _compact()
+		{
+			while (_retained >= _total_capacity)
+			{
+				size_t h = 0;
+				while (_levels[h].size() < _capacities[h])
+					++h;
+				if (h + 1 == _levels.size())
+					_resize_levels(_levels.size() + 1);
+
+				auto& level = _levels[h];
+				stdr::sort(level);
+				// an odd item out stays at this level
+				value_type leftover = level.back();
+				bool odd = level.size() % 2 != 0;
+				if (odd)
+					level.pop_back();
+				size_t promoted = 0;
+				for (size_t i = _random() & 1; i < level.size(); i += 2, ++promoted)
+					_levels[h + 1].push_back(level[i]);
+				_retained -= level.size() - promoted;
+				level.clear();
+				if (odd)
+					level.push_back(leftover);
+			}
+		}
+
+		// (value, weight) pairs of all retained items sorted by value
+		std::vector<std::pair<value_type, std::uint64_t>> _weighted_items() const
+		{
+			std::vector<std::pair<value_type, std::uint64_t>> items;
+			for (size_t h = 0; h != _levels.size(); ++h)
+				for (value_type x : _levels[h])
+					items.emplace_back(x, std::uint64_t(1) << h);
+			stdr::sort(items, {}, &std::pair<value_type, std::uint64_t>::first);
+			return items;
+		}
+
+		static value_type _weighted_quantile(std::span<std::pair<value_type, std::uint64_t> const> items, std::uint64_t total, value_type q)
+		{
+			auto target = q * total;
+			std::uint64_t cumulative = 0;
+			for (auto [x, w] : items)
+			{
+				cumulative += w;
+				if (cumulative >= target)
+					return x;
+			}
+			return items.back().first;
+		}
+	public:
+		// seed picks the offsets of the compactions. Sketches that will be merged, such as one per
+		// thread, should get distinct seeds: with the same one their compactions are correlated
+		// and their errors add up instead of partly cancelling.
+		explicit quantile_sketch(size_t k = default_k, std::uint_fast32_t seed = std::minstd_rand::default_seed)
+			: _k(std::max(k, _min_capacity)), _random(seed)
+		{
+			_resize_levels(1);
+		}
+
+		size_t k() const { return _k; }
+		size_t size() const { return size_t(_size); }
+		bool empty() const { return _size == 0; }
+
+		size_t retained() const { return _retained; }
+
+		// 99% confidence bound on |estimated rank - true rank| / size()
+		value_type normalized_rank_error(bool all_quantiles = false) const
+		{
+			return all_quantiles ? value_type(2.446) / std::pow(value_type(_k), value_type(0.9433)) : value_type(2.296) / std::pow(value_type(_k), value_type(0.9723));
+		}
+
+		void insert(value_type x)
+		{
+			if (std::isnan(x))
+				return;
+			++_size;
+			_min = std::min(_min, x);
+			_max = std::max(_max, x);
+			_levels[0].push_back(x);
+			if (++_retained >= _total_capacity)
+				_compact();
+		}
+
+		void insert(estimate_t<value_type> estimate)
+		{
+			insert(estimate.value());
+		}
+
+		// sketches built in parallel over parts of a sample merge into a sketch of the whole;
+		// both must have the same k, or the error bound of neither would hold
+		void merge(quantile_sketch const& other)
+		{
+			if (other._k != _k)
+				throw std::runtime_error(std::format("Cannot merge a quantile sketch with k = {} into one with k = {}.", other._k, _k));
+			if (other._levels.size() > _levels.size())
+				_resize_levels(other._levels.size());
+			for (size_t h = 0; h != other._levels.size(); ++h)
+				_levels[h].append_range(other._levels[h]);
+			_retained += other._retained;
+			_size += other._size;
+			_min = std::min(_min, other._min);
+			_max = std::max(_max, other._max);
+			_compact();
+		}
+
+		value_type min() const { return _min; }
+		value_type max() const { return _max; }
+
+		// value whose rank is approximately q * size()
+		value_type quantile(value_type q) const
+		{
+			assert(!empty() && 0 <= q && q <= 1);
+			if (q == 0)
+				return _min;
+			if (q == 1)
+				return _max;
+			return _weighted_quantile(_weighted_items(), _size, q);
+		}
+
+		// approximate fraction of the items not greater than x
+		value_type rank(value_type x) const
+		{
+			assert(!empty());
+			std::uint64_t below = 0;
+			for (size_t h = 0; h != _levels.size(); ++h)
+				for (value_type y : _levels[h])
+					if (y <= x)
+						below += std::uint64_t(1) << h;
+			return value_type(below) / _size;
+		}
+
+		value_type median() const { return quantile(value_type(0.5)); }
+
+		// median of |x - median|, computed on the retained weighted items; multiply by
+		// 1.4826 for a robust estimate of the standard deviation of a normal sample.
+		// Error: the result d is exact in rank up to the two ends of [median - d, median + d], so
+		// with 99% confidence the fraction of the items within d of median() is 1/2 +- 2 eps,
+		// eps = normalized_rank_error(true); median() itself has the rank error of quantile().
+		value_type median_absolute_deviation() const
+		{
+			assert(!empty());
+			auto items = _weighted_items();
+			value_type median = _weighted_quantile(items, _size, value_type(0.5));
+			for (auto& [x, w] : items)
+				x = std::abs(x - median);
+			stdr::sort(items, {}, &std::pair<value_type, std::uint64_t>::first);
+			return _weighted_quantile(items, _size, value_type(0.5));
+		}
+	};
+
+	// Companion of analyze_sample for robust statistics: a sketch of the values of a sample
+	// of numbers or estimates.
+	template<typename Sample>
+	auto sketch_sample(Sample&& sample, size_t k = quantile_sketch<>::default_k)
+	{
+		static_assert(stdr::range<Sample>);
+
+		using range_value_t = stdr::range_value_t<Sample>;
+		using value_type = _value_type<range_value_t>::type;
+
+		quantile_sketch<value_type> sketch(k);
+		for (auto x : sample)
+			sketch.insert(x);
+		return sketch;
+	}
+}
\ No newline at end of file
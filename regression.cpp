@@ -31,10 +31,9 @@ export namespace lab
 		};
 	} // namespace _detail
 
-	template<typename Sample>
-	auto regression(Sample&& sample)
+	template<typename ValueType>
+	auto regression(_detail::pair_analysis_result_t<ValueType> const& sample_data)
 	{
-		auto sample_data = analyze_sample(std::forward<Sample>(sample));
 		auto
 			w_sum = sample_data.weight_sum(),
 			w2_sum = sample_data.weight2_sum(),
@@ -49,4 +48,10 @@ export namespace lab
 
 		return _detail::regression_result_t(estimate_t(slope, slope_stderr2), estimate_t(intercept, intercept_stderr2), sample_data);
 	}
+
+	template<typename Sample> requires stdr::range<Sample>
+	auto regression(Sample&& sample)
+	{
+		return regression(analyze_sample(std::forward<Sample>(sample)));
+	}
 }
\ No newline at end of file
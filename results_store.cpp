@@ -0,0 +1,329 @@
+module;
+
+#include <cassert>
+#include <cstddef>
+
+export module lab:results_store;
+
+import :core;
+import :estimate;
+import :serialization;
+
+export namespace lab
+{
+	// Outcome of the analysis of one specimen, stored as a fixed-size binary record.
+	template<typename T = double>
+	struct specimen_record_t
+	{
+		using value_type = T;
+		static_assert(std::floating_point<value_type>);
+
+		std::uint32_t specimen = 0;
+		// days since 1970-01-01 of the analysis, 0 if unknown
+		std::int32_t date = 0;
+		estimate_t<value_type> x0, d, k, e;
+		// of the fit of the force/extension pairs
+		value_type correlation_coefficient = std::numeric_limits<value_type>::quiet_NaN(), chi2 = correlation_coefficient;
+		std::uint32_t points = 0;
+		// where the data came from (input files, logbook reference), NUL padded
+		std::array<char, 44> source{};
+
+		std::chrono::sys_days day() const { return std::chrono::sys_days(std::chrono::days(date)); }
+		void set_day(std::chrono::sys_days day) { date = std::int32_t(day.time_since_epoch().count()); }
+
+		std::string_view source_view() const { return { source.data(), stdr::find(source, '\0') }; }
+		void set_source(std::string_view text)
+		{
+			source.fill('\0');
+			stdr::copy_n(text.begin(), std::min(text.size(), source.size()), source.begin());
+		}
+	};
+
+	namespace _detail
+	{
+		// Layout of the record and index files, after the framing of binary_header_t:
+		//   uint16 sizeof(value_type), uint16 entry size
+		// followed by the fixed-size entries.
+		struct store_header_t
+		{
+			static constexpr std::uint16_t current_version = 1;
+			static constexpr std::streamoff size = binary_header_t::framing_size + 4;
+
+			static void write(std::ostream& output, std::array<char, 8> const& magic, std::uint16_t value_size, std::uint16_t entry_size)
+			{
+				binary_header_t::write_framing(output, magic, current_version);
+				binary_header_t::write_raw(output, value_size);
+				binary_header_t::write_raw(output, entry_size);
+			}
+
+			static void check(std::istream& input, stdf::path const& path, std::array<char, 8> const& magic, std::uint16_t value_size, std::uint16_t entry_size)
+			{
+				binary_header_t::check_framing(input, path.string(), "a file of a results store", magic, current_version);
+				std::array<std::uint16_t, 2> sizes;
+				if (!input.read(reinterpret_cast<char*>(sizes.data()), sizeof(sizes)))
+					throw std::runtime_error(std::format("{} is truncated.", path.string()));
+				if (sizes[0] != value_size || sizes[1] != entry_size)
+					throw std::runtime_error(std::format("{} holds entries of a different type.", path.string()));
+			}
+
+			// opens path for appending, creating it with a header if missing; returns the number of
+			// whole entries, dropping a trailing partial one left by an interrupted append
+			static std::uint64_t open(std::ofstream& output, stdf::path const& path, std::array<char, 8> const& magic, std::uint16_t value_size, std::uint16_t entry_size)
+			{
+				if (!stdf::exists(path))
+				{
+					std::ofstream created(path, std::ios::binary);
+					if (!created)
+						throw std::runtime_error(std::format("Cannot open {} for writing.", path.string()));
+					write(created, magic, value_size, entry_size);
+				}
+				else
+				{
+					std::ifstream input(path, std::ios::binary);
+					if (!input)
+						throw std::runtime_error(std::format("Cannot open {} for reading.", path.string()));
+					check(input, path, magic, value_size, entry_size);
+				}
+
+				auto file_size = stdf::file_size(path);
+				if (file_size < std::uintmax_t(size))
+					throw std::runtime_error(std::format("{} is truncated.", path.string()));
+				std::uint64_t count = (file_size - size) / entry_size;
+				if (size + count * entry_size != file_size)
+					stdf::resize_file(path, size + count * entry_size);
+
+				output.open(path, std::ios::binary | std::ios::app);
+				if (!output)
+					throw std::runtime_error(std::format("Cannot open {} for writing.", path.string()));
+				output.exceptions(output.badbit | output.failbit);
+				return count;
+			}
+		};
+
+		// Secondary index: (key, record number) pairs appended to a file in record order and kept
+		// sorted in memory, so a range of keys maps to its records with two binary searches.
+		template<typename Key>
+		class store_index_t
+		{
+			// keys are never NaN (results_store::append rejects them), so the order is total
+			struct entry_t
+			{
+				Key key;
+				std::uint64_t record;
+
+				auto operator<=>(entry_t const&) const = default;
+			};
+			static_assert(std::is_trivially_copyable_v<entry_t> && std::is_standard_layout_v<entry_t>);
+
+			static constexpr std::array<char, 8> _magic = { 'L', 'A', 'B', 'I', 'D', 'X', 0, 0 };
+
+			stdf::path _path;
+			std::ofstream _output;
+			std::vector<entry_t> _entries;
+			// cleared by an entry appended out of key order, restored by the next query
+			bool _sorted = true;
+
+			void _sort()
+			{
+				if (!_sorted)
+				{
+					stdr::sort(_entries);
+					_sorted = true;
+				}
+			}
+		public:
+			// loads the index of a store of record_count records; key_of(n) gives the key of record n
+			// for the entries an interrupted append did not write
+			store_index_t(stdf::path path, std::uint64_t record_count, auto const& key_of)
+				: _path(std::move(path))
+			{
+				auto count = store_header_t::open(_output, _path, _magic, sizeof(Key), sizeof(entry_t));
+				if (count > record_count)
+				{
+					_output.close();
+					stdf::resize_file(_path, store_header_t::size + record_count * sizeof(entry_t));
+					_output.open(_path, std::ios::binary | std::ios::app);
+					count = record_count;
+				}
+
+				_entries.resize(count);
+				std::ifstream input(_path, std::ios::binary);
+				input.seekg(store_header_t::size);
+				if (!input.read(reinterpret_cast<char*>(_entries.data()), std::streamsize(count * sizeof(entry_t))))
+					throw std::runtime_error(std::format("Cannot read {}.", _path.string()));
+
+				for (std::uint64_t n = count; n != record_count; ++n)
+					add(key_of(n), n);
+				flush();
+				stdr::sort(_entries);
+				_sorted = true;
+			}
+
+			void add(Key key, std::uint64_t record)
+			{
+				entry_t entry{ key, record };
+				// written field by field into zeroed bytes, so the padding after a 4-byte key is not
+				// whatever happened to be in memory
+				std::array<char, sizeof(entry_t)> bytes{};
+				std::memcpy(bytes.data() + offsetof(entry_t, key), &entry.key, sizeof(entry.key));
+				std::memcpy(bytes.data() + offsetof(entry_t, record), &entry.record, sizeof(entry.record));
+				_output.write(bytes.data(), bytes.size());
+				_sorted = _sorted && (_entries.empty() || _entries.back() < entry);
+				_entries.push_back(entry);
+			}
+
+			void flush() { _output.flush(); }
+
+			// numbers of the records with min <= key <= max, ascending
+			std::vector<std::uint64_t> range(Key min, Key max)
+			{
+				_sort();
+				auto first = stdr::lower_bound(_entries, min, {}, &entry_t::key);
+				auto last = stdr::upper_bound(first, _entries.end(), max, {}, &entry_t::key);
+
+				std::vector<std::uint64_t> records(std::from_range, stdr::subrange(first, last) | stdv::transform(&entry_t::record));
+				stdr::sort(records);
+				return records;
+			}
+
+			// number of the last record of each key, ascending
+			std::vector<std::uint64_t> last_per_key()
+			{
+				_sort();
+				std::vector<std::uint64_t> records;
+				for (size_t i = 0; i != _entries.size(); ++i)
+					if (i + 1 == _entries.size() || _entries[i + 1].key != _entries[i].key)
+						records.push_back(_entries[i].record);
+				stdr::sort(records);
+				return records;
+			}
+		};
+	} // namespace _detail
+
+	// which records a range query of results_store returns
+	enum class store_selection
+	{
+		all,		// every record in the range
+		latest		// only records that are the latest of their specimen in the whole store, so a
+					// specimen whose x0, d or date was corrected later is not returned by its old values
+	};
+
+	// Append-only store of specimen records in a directory: records.bin holds the records,
+	// length.idx, diameter.idx, date.idx and specimen.idx index them by x0, d, date and
+	// specimen number. Only the indexes are loaded on opening; a query reads just the records
+	// in its key range, in file order. Queries return records in the order they were appended,
+	// so the last record of a specimen is its latest analysis.
+	template<typename T = double>
+	class results_store
+	{
+	public:
+		using value_type = T;
+		using record_type = specimen_record_t<value_type>;
+		static_assert(std::is_trivially_copyable_v<record_type>);
+	private:
+		static constexpr std::array<char, 8> _magic = { 'L', 'A', 'B', 'R', 'E', 'S', 0, 0 };
+
+		stdf::path _records_path;
+		std::ofstream _output;
+		std::uint64_t _size;
+		std::ifstream _input;
+		_detail::store_index_t<value_type> _length, _diameter;
+		_detail::store_index_t<std::int32_t> _date;
+		_detail::store_index_t<std::uint32_t> _specimen;
+
+		static stdf::path _create_directory(stdf::path const& directory)
+		{
+			stdf::create_directories(directory);
+			return directory / "records.bin";
+		}
+
+		auto _index(char const* name, auto key_of)
+		{
+			return _detail::store_index_t<decltype(key_of(std::declval<record_type>()))>(_records_path.parent_path() / name, _size, [&](std::uint64_t n) { return key_of(at(n)); });
+		}
+
+		std::vector<record_type> _read(std::vector<std::uint64_t> records, store_selection selection = store_selection::all)
+		{
+			if (selection == store_selection::latest)
+			{
+				auto latest = _specimen.last_per_key();
+				std::erase_if(records, [&](std::uint64_t n) { return !stdr::binary_search(latest, n); });
+			}
+
+			std::vector<record_type> result(records.size());
+			for (size_t i = 0; i != records.size(); ++i)
+				result[i] = at(records[i]);
+			return result;
+		}
+	public:
+		// opens the store in directory, creating it if missing
+		explicit results_store(stdf::path const& directory)
+			: _records_path(_create_directory(directory))
+			, _size(_detail::store_header_t::open(_output, _records_path, _magic, sizeof(value_type), sizeof(record_type)))
+			, _input(_records_path, std::ios::binary)
+			, _length(_index("length.idx", [](record_type const& r) { return r.x0.value(); }))
+			, _diameter(_index("diameter.idx", [](record_type const& r) { return r.d.value(); }))
+			, _date(_index("date.idx", [](record_type const& r) { return r.date; }))
+			, _specimen(_index("specimen.idx", [](record_type const& r) { return r.specimen; }))
+		{}
+
+		size_t size() const { return size_t(_size); }
+
+		record_type at(std::uint64_t n)
+		{
+			if (n >= _size)
+				throw std::runtime_error(std::format("Record {} out of range ({} records).", n, _size));
+			record_type record;
+			_input.clear();
+			_input.seekg(_detail::store_header_t::size + std::streamoff(n * sizeof(record_type)));
+			if (!_input.read(reinterpret_cast<char*>(&record), sizeof(record)))
+				throw std::runtime_error(std::format("Cannot read record {} of {}.", n, _records_path.string()));
+			return record;
+		}
+
+		// the record reaches the disk before its index entries, so an interrupted append is
+		// either dropped or completed when the store is opened again; returns its number
+		std::uint64_t append(record_type const& record)
+		{
+			if (!std::isfinite(record.x0.value()) || !std::isfinite(record.d.value()))
+				throw std::runtime_error(std::format("Record of specimen {} has no finite x0 and d to index (x0 = {}, d = {}).", record.specimen, record.x0.value(), record.d.value()));
+			_output.write(reinterpret_cast<char const*>(&record), sizeof(record));
+			_output.flush();
+			std::uint64_t n = _size++;
+			_length.add(record.x0.value(), n);
+			_diameter.add(record.d.value(), n);
+			_date.add(record.date, n);
+			_specimen.add(record.specimen, n);
+			_length.flush();
+			_diameter.flush();
+			_date.flush();
+			_specimen.flush();
+			return n;
+		}
+
+		// records with min <= x0 <= max
+		std::vector<record_type> by_length(value_type min, value_type max, store_selection selection = store_selection::all)
+		{
+			return _read(_length.range(min, max), selection);
+		}
+		// records with min <= d <= max
+		std::vector<record_type> by_diameter(value_type min, value_type max, store_selection selection = store_selection::all)
+		{
+			return _read(_diameter.range(min, max), selection);
+		}
+		// records analyzed between first and last, both included
+		std::vector<record_type> by_date(std::chrono::sys_days first, std::chrono::sys_days last, store_selection selection = store_selection::all)
+		{
+			return _read(_date.range(std::int32_t(first.time_since_epoch().count()), std::int32_t(last.time_since_epoch().count())), selection);
+		}
+		std::vector<record_type> by_specimen(std::uint32_t specimen) { return _read(_specimen.range(specimen, specimen)); }
+
+		std::optional<record_type> latest(std::uint32_t specimen)
+		{
+			auto records = _specimen.range(specimen, specimen);
+			if (records.empty())
+				return std::nullopt;
+			return at(records.back());
+		}
+	};
+}
\ No newline at end of file
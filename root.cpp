@@ -19,11 +19,13 @@ export namespace lab
 		Range&& data,
 		auto const& regression_data,
 		stdf::path const& path,
-		size_t height = 4096, size_t width = 2160)
+		size_t height = 4096, size_t width = 2160,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource())
 	{
 		static_assert(stdr::range<Range>);
 
-		std::vector<double> x, y, ex, ey;
+		// ROOT allocates on its own, only the point buffers come from resource
+		std::pmr::vector<double> x(resource), y(resource), ex(resource), ey(resource);
 		double x_min = std::numeric_limits<double>::infinity(), x_max = -x_min, y_min = x_min, y_max = x_max;
 		if constexpr (stdr::sized_range<Range>)
 		{
@@ -0,0 +1,179 @@
+module;
+
+#include <cassert>
+
+export module lab:segmented_regression;
+
+import :core;
+import :estimate;
+import :sample;
+import :regression;
+
+export namespace lab
+{
+	namespace _detail
+	{
+		// weighted sums of a sample, shifted by a reference point to limit cancellation
+		template<typename ValueType>
+		struct weighted_moments_t
+		{
+			using value_type = ValueType;
+
+			value_type w = 0, w2 = 0, wx = 0, wy = 0, wxx = 0, wxy = 0, wyy = 0;
+
+			friend weighted_moments_t operator-(weighted_moments_t const& lhs, weighted_moments_t const& rhs)
+			{
+				return {
+					lhs.w - rhs.w, lhs.w2 - rhs.w2,
+					lhs.wx - rhs.wx, lhs.wy - rhs.wy,
+					lhs.wxx - rhs.wxx, lhs.wxy - rhs.wxy, lhs.wyy - rhs.wyy
+				};
+			}
+		};
+
+		template<typename ValueType>
+		struct segmented_regression_result_t
+		{
+			using value_type = ValueType;
+		private:
+			std::vector<size_t> _breakpoints;
+			std::vector<regression_result_t<value_type>> _segments;
+			value_type _chi2;
+		public:
+			segmented_regression_result_t(std::vector<size_t> breakpoints, std::vector<regression_result_t<value_type>> segments, value_type chi2)
+				: _breakpoints(std::move(breakpoints)), _segments(std::move(segments)), _chi2(chi2) {}
+
+			// index of the first point of every segment but the first one
+			std::span<size_t const> breakpoints() const { return _breakpoints; }
+			std::span<regression_result_t<value_type> const> segments() const { return _segments; }
+			// weighted sum of the squared residuals over all segments
+			value_type chi2() const { return _chi2; }
+		};
+	} // namespace _detail
+
+	// Piecewise linear fit of an ordered sample into the given number of contiguous segments,
+	// minimizing the total weighted squared residual. Segment statistics come from prefix sums
+	// of the weighted moments, so each candidate segment costs O(1): a single breakpoint is
+	// found in O(n), k segments by dynamic programming in O(k n^2).
+	// The elastic limit of a specimen is segmented_regression(sample, 2).breakpoints()[0].
+	template<typename Sample>
+	auto segmented_regression(Sample&& sample, size_t segments = 2, size_t min_segment_size = 3)
+	{
+		static_assert(stdr::range<Sample>);
+
+		using range_value_t = stdr::range_value_t<Sample>;
+		using first_type = std::tuple_element_t<0, range_value_t>;
+		using second_type = std::tuple_element_t<1, range_value_t>;
+		using value_type = std::common_type_t<typename _value_type<first_type>::type, typename _value_type<second_type>::type>;
+		using moments_t = _detail::weighted_moments_t<value_type>;
+
+		assert(segments != 0 && min_segment_size >= 2);
+
+		// prefix[i] holds the moments of the first i points, y weighted by its inverse variance as in analyze_sample
+		std::vector<moments_t> prefix(1);
+		value_type x_shift = 0, y_shift = 0;
+		for (auto [x_sample, y_sample] : sample)
+		{
+			value_type x, y, w;
+			if constexpr (is_estimate<first_type> && is_estimate<second_type>)
+			{
+				x = x_sample.value();
+				y = y_sample.value();
+				w = 1 / y_sample.variance();
+			}
+			else
+			{
+				static_assert(std::floating_point<first_type> && std::floating_point<second_type>);
+				x = x_sample;
+				y = y_sample;
+				w = 1;
+			}
+			// a zero, infinite or NaN variance would make the costs NaN and the breakpoints meaningless
+			if (!(w > 0) || !std::isfinite(w) || !std::isfinite(x) || !std::isfinite(y))
+				throw std::runtime_error(std::format("Point {} is not usable: x = {}, y = {} and weight = {} must be finite, the weight positive.", prefix.size() - 1, x, y, w));
+			if (prefix.size() == 1)
+			{
+				x_shift = x;
+				y_shift = y;
+			}
+			x -= x_shift;
+			y -= y_shift;
+
+			moments_t m = prefix.back();
+			m.w += w;
+			m.w2 += w * w;
+			m.wx += w * x;
+			m.wy += w * y;
+			m.wxx += w * x * x;
+			m.wxy += w * x * y;
+			m.wyy += w * y * y;
+			prefix.push_back(m);
+		}
+		size_t size = prefix.size() - 1;
+		if (size < segments * min_segment_size)
+			throw std::runtime_error(std::format("Cannot split {} points into {} segments of at least {} points.", size, segments, min_segment_size));
+
+		auto cost = [&](size_t first, size_t last)
+		{
+			moments_t m = prefix[last] - prefix[first];
+			value_type
+				sxx = m.wxx - m.wx * m.wx / m.w,
+				sxy = m.wxy - m.wx * m.wy / m.w,
+				syy = m.wyy - m.wy * m.wy / m.w;
+			return sxx > 0 ? std::max(syy - sxy * sxy / sxx, value_type(0)) : syy;
+		};
+
+		auto fit = [&](size_t first, size_t last)
+		{
+			moments_t m = prefix[last] - prefix[first];
+			value_type
+				x_mean = m.wx / m.w,
+				y_mean = m.wy / m.w,
+				factor = 1 / (m.w - m.w2 / m.w);
+			return regression(_detail::pair_analysis_result_t<value_type>(
+				last - first,
+				x_shift + x_mean, (m.wxx - m.wx * x_mean) * factor,
+				y_shift + y_mean, (m.wyy - m.wy * y_mean) * factor,
+				(m.wxy - m.wx * y_mean) * factor,
+				m.w, m.w2));
+		};
+
+		// best[s][j]: lowest cost of s + 1 segments covering the first j points, from[s][j] the start of the last one;
+		// only the full sample is needed for the last layer
+		constexpr value_type infinity = std::numeric_limits<value_type>::infinity();
+		std::vector<std::vector<value_type>> best(segments, std::vector<value_type>(size + 1, infinity));
+		std::vector<std::vector<size_t>> from(segments, std::vector<size_t>(size + 1, 0));
+		for (size_t j = min_segment_size; j <= size; ++j)
+			best[0][j] = cost(0, j);
+		for (size_t s = 1; s != segments; ++s)
+		{
+			size_t first_end = (s + 1) * min_segment_size;
+			for (size_t j = s + 1 == segments ? size : first_end; j <= size; ++j)
+			{
+				for (size_t i = s * min_segment_size; i + min_segment_size <= j; ++i)
+				{
+					value_type candidate = best[s - 1][i] + cost(i, j);
+					if (candidate < best[s][j])
+					{
+						best[s][j] = candidate;
+						from[s][j] = i;
+					}
+				}
+			}
+		}
+
+		std::vector<size_t> breakpoints(segments - 1);
+		for (size_t s = segments - 1, j = size; s != 0; --s)
+			j = breakpoints[s - 1] = from[s][j];
+
+		std::vector<_detail::regression_result_t<value_type>> fits;
+		fits.reserve(segments);
+		for (size_t s = 0, first = 0; s != segments; ++s)
+		{
+			size_t last = s + 1 == segments ? size : breakpoints[s];
+			fits.push_back(fit(first, last));
+			first = last;
+		}
+		return _detail::segmented_regression_result_t<value_type>(std::move(breakpoints), std::move(fits), best[segments - 1][size]);
+	}
+}
\ No newline at end of file
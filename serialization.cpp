@@ -0,0 +1,60 @@
+export module lab:serialization;
+
+import :core;
+
+export namespace lab
+{
+	namespace _detail
+	{
+		// Framing shared by the binary files of lab (accumulator states, results store records
+		// and indexes), native byte order:
+		//   char magic[8], uint16 version, uint16 byte_order_mark = 0xFEFF
+		// followed by a layout specific to the magic, described where the magic is defined.
+		// Readers check the magic, then the byte order mark (a file from a machine of the other
+		// endianness reads it as 0xFFFE), then the version.
+		struct binary_header_t
+		{
+			static constexpr std::uint16_t byte_order_mark = 0xFEFF;
+			static constexpr std::streamoff framing_size = 12;
+
+			static void write_framing(std::ostream& output, std::array<char, 8> const& magic, std::uint16_t version)
+			{
+				output.write(magic.data(), magic.size());
+				write_raw(output, version);
+				write_raw(output, byte_order_mark);
+			}
+
+			// what names the input in error messages, expected the kind of file it should be
+			static void check_framing(std::istream& input, std::string_view what, std::string_view expected, std::array<char, 8> const& magic, std::uint16_t version)
+			{
+				std::array<char, 8> file_magic;
+				std::array<std::uint16_t, 2> fields;
+				input.read(file_magic.data(), file_magic.size());
+				input.read(reinterpret_cast<char*>(fields.data()), sizeof(fields));
+				if (!input || file_magic != magic)
+					throw std::runtime_error(std::format("{} is not {}.", what, expected));
+				if (fields[1] != byte_order_mark)
+					throw std::runtime_error(std::format("{} was written with a different byte order.", what));
+				if (fields[0] != version)
+					throw std::runtime_error(std::format("{} has unsupported version {} (expected {}).", what, fields[0], version));
+			}
+
+			template<typename U>
+			static void write_raw(std::ostream& output, U value)
+			{
+				static_assert(std::is_trivially_copyable_v<U>);
+				output.write(reinterpret_cast<char const*>(&value), sizeof(U));
+			}
+
+			template<typename U>
+			static U read_raw(std::istream& input)
+			{
+				static_assert(std::is_trivially_copyable_v<U>);
+				U value;
+				if (!input.read(reinterpret_cast<char*>(&value), sizeof(U)))
+					throw std::runtime_error("Truncated binary data.");
+				return value;
+			}
+		};
+	} // namespace _detail
+}
\ No newline at end of file
@@ -0,0 +1,274 @@
+import lab;
+
+namespace stdv = std::views;
+namespace stdr = std::ranges;
+namespace stdf = std::filesystem;
+
+// Splits a whitespace separated data file between worker processes, each writing the
+// accumulator state of its part, and merges the states into the result of the whole file.
+//
+// shards run <input> <workers>                              spawn the workers and merge their states
+// shards worker <input> <index> <count> <columns> <output>  accumulate lines of the index-th byte range
+// shards merge <state>...                                   merge states and print the result
+//
+// Lines hold one value (sample), "x y" (pairs) or "x y sigma_y" (pairs weighted by 1/sigma_y^2).
+
+using value_type = double;
+using estimate_t = lab::estimate_t<value_type>;
+using accumulator_t = std::variant<lab::sample_accumulator<value_type>, lab::pair_accumulator<value_type>>;
+
+size_t parse_line(std::string_view line, std::array<value_type, 3>& values)
+{
+	size_t count = 0;
+	char const* first = line.data(), * last = line.data() + line.size();
+	while (count != values.size())
+	{
+		while (first != last && std::isspace(static_cast<unsigned char>(*first)))
+			++first;
+		if (first == last)
+			break;
+		auto [ptr, ec] = std::from_chars(first, last, values[count]);
+		if (ec != std::errc())
+			throw std::runtime_error(std::format("Cannot parse \"{}\".", line));
+		first = ptr;
+		++count;
+	}
+	// more columns than any supported layout: refuse rather than read the first three
+	while (first != last && std::isspace(static_cast<unsigned char>(*first)))
+		++first;
+	if (first != last)
+		throw std::runtime_error(std::format("Unexpected data after {} columns in \"{}\".", values.size(), line));
+	return count;
+}
+
+size_t count_columns(stdf::path const& path)
+{
+	std::ifstream input(path);
+	if (!input)
+		throw std::runtime_error(std::format("Cannot open {} for reading.", path.string()));
+
+	std::array<value_type, 3> values;
+	for (std::string line; std::getline(input, line);)
+		if (size_t columns = parse_line(line, values))
+			return columns;
+	throw std::runtime_error(std::format("{} holds no data.", path.string()));
+}
+
+accumulator_t make_accumulator(size_t columns)
+{
+	switch (columns)
+	{
+	case 1: return lab::sample_accumulator<value_type>();
+	case 2: return lab::pair_accumulator<value_type>();
+	case 3: return lab::pair_accumulator<value_type>(true);
+	default: throw std::runtime_error(std::format("Unsupported number of columns {}.", columns));
+	}
+}
+
+// accumulates the lines starting in [size * index / count, size * (index + 1) / count)
+accumulator_t accumulate_shard(stdf::path const& path, size_t index, size_t count, size_t columns)
+{
+	std::ifstream input(path, std::ios::binary);
+	if (!input)
+		throw std::runtime_error(std::format("Cannot open {} for reading.", path.string()));
+	input.exceptions(input.badbit);
+
+	auto size = stdf::file_size(path);
+	std::uint64_t begin = size * index / count, end = size * (index + 1) / count;
+
+	// a line starting exactly at begin belongs to this shard, one running across it to the previous one
+	std::uint64_t position = begin;
+	if (begin != 0)
+	{
+		input.seekg(std::streamoff(begin - 1));
+		std::string skipped;
+		std::getline(input, skipped);
+		position = begin - 1 + skipped.size() + 1;
+	}
+
+	auto accumulator = make_accumulator(columns);
+	std::array<value_type, 3> values;
+	for (std::string line; position < end && std::getline(input, line); position += line.size() + 1)
+	{
+		size_t line_columns = parse_line(line, values);
+		if (line_columns == 0)
+			continue;
+		if (line_columns != columns)
+			throw std::runtime_error(std::format("Expected {} columns, found \"{}\".", columns, line));
+
+		std::visit([&]<typename Accumulator>(Accumulator& acc)
+		{
+			if constexpr (std::same_as<Accumulator, lab::sample_accumulator<value_type>>)
+				acc.add(values[0]);
+			else if (columns == 2)
+				acc.add(values[0], values[1]);
+			else
+				acc.add(estimate_t(values[0], 0), estimate_t(lab::from_stddev, values[1], values[2]));
+		}, accumulator);
+	}
+	return accumulator;
+}
+
+accumulator_t merge_states(std::span<stdf::path const> paths)
+{
+	std::optional<accumulator_t> merged;
+	for (auto const& path : paths)
+	{
+		std::ifstream input(path, std::ios::binary);
+		if (!input)
+			throw std::runtime_error(std::format("Cannot open {} for reading.", path.string()));
+
+		auto state = lab::read_accumulator<value_type>(input);
+		if (!merged)
+		{
+			merged = state;
+			continue;
+		}
+		if (merged->index() != state.index())
+			throw std::runtime_error(std::format("{} holds a different kind of sample.", path.string()));
+		std::visit([&]<typename Accumulator>(Accumulator& acc)
+		{
+			auto const& other = std::get<Accumulator>(state);
+			if (acc.weighted() != other.weighted())
+				throw std::runtime_error(std::format("{} mixes weighted and unweighted samples.", path.string()));
+			acc.merge(other);
+		}, *merged);
+	}
+	if (!merged)
+		throw std::runtime_error("No states to merge.");
+	return *merged;
+}
+
+void print_result(accumulator_t const& accumulator)
+{
+	std::visit([]<typename Accumulator>(Accumulator const& acc)
+	{
+		if constexpr (std::same_as<Accumulator, lab::sample_accumulator<value_type>>)
+		{
+			auto result = acc.result();
+			std::print("N = {}\nMedia = {}\nVarianza = {}\n", result.size(), result.mean(), result.variance());
+		}
+		else
+		{
+			auto result = lab::regression(acc.result());
+			std::print("N = {}\ny = ({}) * x + {}\nCoefficiente di correlazione: {}\n",
+				result.sample().size(), result.slope(), result.intercept(), result.correlation_coefficient());
+		}
+	}, accumulator);
+}
+
+void write_state(accumulator_t const& accumulator, stdf::path const& path)
+{
+	std::ofstream output(path, std::ios::binary);
+	if (!output)
+		throw std::runtime_error(std::format("Cannot open {} for writing.", path.string()));
+	output.exceptions(output.badbit | output.failbit);
+	std::visit([&](auto const& acc) { acc.write(output); }, accumulator);
+}
+
+// This program, to start the workers with: argv0 when it names a file, else the file the shell
+// found through PATH.
+stdf::path executable_path(stdf::path const& argv0)
+{
+	if (argv0.has_parent_path())
+		return stdf::absolute(argv0);
+
+#ifdef _WIN32
+	constexpr char separator = ';';
+	// the current directory is searched first
+	std::string search_path = ".;";
+#else
+	constexpr char separator = ':';
+	std::string search_path;
+#endif
+	if (char const* path = std::getenv("PATH"))
+		search_path += path;
+	for (auto directory : search_path | stdv::split(separator))
+	{
+		auto candidate = stdf::path(std::string_view(directory)) / argv0;
+#ifdef _WIN32
+		if (!candidate.has_extension())
+			candidate += ".exe";
+#endif
+		if (std::error_code error; stdf::is_regular_file(candidate, error))
+			return stdf::absolute(candidate);
+	}
+	throw std::runtime_error(std::format("Cannot find {} in PATH to start the workers.", argv0.string()));
+}
+
+void run(stdf::path const& self, stdf::path const& input_path, size_t workers)
+{
+	size_t columns = count_columns(input_path);
+
+	std::vector<stdf::path> state_paths;
+	std::vector<std::future<int>> processes;
+	for (size_t i = 0; i != workers; ++i)
+	{
+		auto state_path = input_path;
+		state_path += std::format(".shard{}.acc", i);
+		state_paths.push_back(state_path);
+
+		auto command = std::format("\"{}\" worker \"{}\" {} {} {} \"{}\"", self.string(), input_path.string(), i, workers, columns, state_path.string());
+		processes.push_back(std::async(std::launch::async, [command] { return std::system(command.c_str()); }));
+	}
+	for (auto [i, process] : stdv::enumerate(processes))
+		if (int status = process.get(); status != 0)
+			throw std::runtime_error(std::format("Worker {} failed with status {}.", i, status));
+
+	std::print("Risultato da {} processi:\n", workers);
+	print_result(merge_states(state_paths));
+
+	std::print("\nRisultato in un solo passaggio:\n");
+	print_result(accumulate_shard(input_path, 0, 1, columns));
+
+	for (auto const& path : state_paths)
+		stdf::remove(path);
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		std::vector<std::string_view> args(argv, argv + argc);
+		auto to_size = [](std::string_view arg)
+		{
+			size_t value = 0;
+			auto [ptr, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+			if (ec != std::errc() || ptr != arg.data() + arg.size())
+				throw std::runtime_error(std::format("Invalid number \"{}\".", arg));
+			return value;
+		};
+
+		if (args.size() == 4 && args[1] == "run")
+		{
+			size_t workers = to_size(args[3]);
+			if (workers == 0)
+				throw std::runtime_error("At least one worker is needed.");
+			run(executable_path(argv[0]), args[2], workers);
+		}
+		else if (args.size() == 7 && args[1] == "worker")
+		{
+			size_t index = to_size(args[3]), count = to_size(args[4]);
+			if (count == 0 || index >= count)
+				throw std::runtime_error(std::format("Invalid shard {} of {}.", index, count));
+			write_state(accumulate_shard(args[2], index, count, to_size(args[5])), args[6]);
+		}
+		else if (args.size() >= 3 && args[1] == "merge")
+			print_result(merge_states(std::vector<stdf::path>(args.begin() + 2, args.end())));
+		else
+		{
+			std::print(std::cerr,
+				"Uso:\n"
+				"  {0} run <input> <workers>\n"
+				"  {0} worker <input> <index> <count> <columns> <output>\n"
+				"  {0} merge <state>...\n",
+				args[0]);
+			return 2;
+		}
+	}
+	catch (std::exception const& e)
+	{
+		std::print(std::cerr, "{}\n", e.what());
+		return 1;
+	}
+}
\ No newline at end of file
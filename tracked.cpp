@@ -0,0 +1,445 @@
+module;
+
+#include <cassert>
+
+export module lab:tracked;
+
+import :core;
+import :estimate;
+
+export namespace lab
+{
+	template<typename T>
+	class tracked_estimate_t;
+
+	template<typename T>
+	class tracked_accumulator;
+
+	// Registry of the named independent uncertainty sources and arena for the sensitivity
+	// vectors of derived estimates that do not fit inline. Derived estimates keep a pointer
+	// to their context, which therefore can be neither copied nor moved.
+	template<typename T = double>
+	class uncertainty_context
+	{
+	public:
+		using value_type = T;
+		using source_id = std::uint32_t;
+		static_assert(std::floating_point<value_type>);
+	private:
+		struct _source
+		{
+			std::string name;
+			value_type variance;
+		};
+
+		std::vector<_source> _sources;
+		std::pmr::monotonic_buffer_resource _arena;
+
+		friend class tracked_estimate_t<value_type>;
+		friend class tracked_accumulator<value_type>;
+
+		template<typename Term>
+		Term* _allocate_terms(size_t count)
+		{
+			return static_cast<Term*>(_arena.allocate(count * sizeof(Term), alignof(Term)));
+		}
+	public:
+		uncertainty_context() = default;
+
+		explicit uncertainty_context(size_t initial_arena_size)
+			: _arena(initial_arena_size) {}
+
+		uncertainty_context(uncertainty_context const&) = delete;
+		uncertainty_context& operator=(uncertainty_context const&) = delete;
+
+		tracked_estimate_t<value_type> independent(std::string_view name, estimate_t<value_type> estimate);
+
+		size_t source_count() const { return _sources.size(); }
+		std::string_view name(source_id source) const { return _sources[source].name; }
+		value_type variance(source_id source) const { return _sources[source].variance; }
+
+		// frees every spilled sensitivity vector: estimates derived so far must not be used afterwards
+		void release() { _arena.release(); }
+	};
+
+	// Estimate carrying its sensitivities d(value)/d(source) to the independent sources of
+	// an uncertainty_context, so that shared inputs are accounted for when propagating.
+	// Up to inline_capacity sensitivities are stored inline; longer vectors are spilled to
+	// the context arena and never modified afterwards, which keeps copies cheap.
+	template<typename T = double>
+	class tracked_estimate_t
+	{
+	public:
+		using value_type = T;
+		using context_type = uncertainty_context<value_type>;
+		using source_id = context_type::source_id;
+		static_assert(std::floating_point<value_type>);
+
+		struct term_t
+		{
+			source_id source;
+			value_type sensitivity;
+		};
+
+		static constexpr size_t inline_capacity = 4;
+	private:
+		context_type* _context = nullptr;
+		value_type _value;
+		std::uint32_t _size = 0;
+		term_t const* _spilled = nullptr;
+		std::array<term_t, inline_capacity> _inline;
+
+		friend class uncertainty_context<value_type>;
+
+		friend class tracked_accumulator<value_type>;
+
+		// estimate holding a copy of terms, sorted by source, spilled to the context arena if needed
+		static tracked_estimate_t _from_terms(context_type* context, value_type value, std::span<term_t const> terms)
+		{
+			tracked_estimate_t result(value);
+			result._context = context;
+			result._size = std::uint32_t(terms.size());
+			term_t* out = terms.size() <= inline_capacity ? result._inline.data() : context->template _allocate_terms<term_t>(terms.size());
+			stdr::copy(terms, out);
+			if (out != result._inline.data())
+				result._spilled = out;
+			return result;
+		}
+	public:
+		tracked_estimate_t()
+			: _value(std::numeric_limits<value_type>::quiet_NaN())
+		{}
+
+		// exact value, no uncertainty
+		tracked_estimate_t(value_type value)
+			: _value(value)
+		{}
+
+		tracked_estimate_t(tracked_estimate_t const& other)
+			: _context(other._context), _value(other._value), _size(other._size), _spilled(other._spilled)
+		{
+			if (!_spilled)
+				std::copy_n(other._inline.data(), _size, _inline.data());
+		}
+
+		tracked_estimate_t& operator=(tracked_estimate_t const& other)
+		{
+			_context = other._context;
+			_value = other._value;
+			_size = other._size;
+			_spilled = other._spilled;
+			if (!_spilled)
+				std::copy_n(other._inline.data(), _size, _inline.data());
+			return *this;
+		}
+
+		// factors[0] * *arguments[0] + ... + factors[N-1] * *arguments[N-1] to first order, with the
+		// given value: a single N-way merge of the sorted sensitivity vectors, counted first so that
+		// the result takes exactly one block of the arena when it does not fit inline
+		template<size_t N>
+		static tracked_estimate_t linear_combination(value_type value, std::array<tracked_estimate_t const*, N> const& arguments, std::array<value_type, N> const& factors)
+		{
+			tracked_estimate_t result(value);
+			std::array<std::span<term_t const>, N> terms;
+			for (size_t n = 0; n != N; ++n)
+			{
+				assert(result._context == nullptr || arguments[n]->_context == nullptr || arguments[n]->_context == result._context);
+				if (!result._context)
+					result._context = arguments[n]->_context;
+				terms[n] = arguments[n]->sensitivities();
+			}
+
+			auto merge = [&](auto emit)
+			{
+				std::array<size_t, N> next{};
+				while (true)
+				{
+					auto source = std::numeric_limits<source_id>::max();
+					bool done = true;
+					for (size_t n = 0; n != N; ++n)
+						if (next[n] != terms[n].size())
+						{
+							source = std::min(source, terms[n][next[n]].source);
+							done = false;
+						}
+					if (done)
+						return;
+
+					value_type sensitivity = 0;
+					for (size_t n = 0; n != N; ++n)
+						if (next[n] != terms[n].size() && terms[n][next[n]].source == source)
+							sensitivity += factors[n] * terms[n][next[n]++].sensitivity;
+					if (sensitivity != 0)
+						emit(term_t{ source, sensitivity });
+				}
+			};
+
+			size_t size = 0;
+			merge([&](term_t) { ++size; });
+			term_t* out = size <= inline_capacity ? result._inline.data() : result._context->template _allocate_terms<term_t>(size);
+			result._size = std::uint32_t(size);
+			size = 0;
+			merge([&](term_t term) { out[size++] = term; });
+			if (out != result._inline.data())
+				result._spilled = out;
+			return result;
+		}
+
+		value_type value() const { return _value; }
+
+		std::span<term_t const> sensitivities() const
+		{
+			return { _spilled ? _spilled : _inline.data(), _size };
+		}
+
+		value_type variance() const
+		{
+			value_type variance = 0;
+			for (auto [source, sensitivity] : sensitivities())
+				variance += sensitivity * sensitivity * _context->variance(source);
+			return variance;
+		}
+		value_type stddev() const { return std::sqrt(variance()); }
+
+		estimate_t<value_type> to_estimate() const { return { value(), variance() }; }
+
+		friend value_type covariance(tracked_estimate_t const& lhs, tracked_estimate_t const& rhs)
+		{
+			assert(lhs._context == nullptr || rhs._context == nullptr || lhs._context == rhs._context);
+
+			auto l = lhs.sensitivities(), r = rhs.sensitivities();
+			value_type covariance = 0;
+			for (size_t i = 0, j = 0; i != l.size() && j != r.size();)
+			{
+				if (l[i].source < r[j].source)
+					++i;
+				else if (r[j].source < l[i].source)
+					++j;
+				else
+				{
+					covariance += l[i].sensitivity * r[j].sensitivity * lhs._context->variance(l[i].source);
+					++i;
+					++j;
+				}
+			}
+			return covariance;
+		}
+
+		friend value_type correlation(tracked_estimate_t const& lhs, tracked_estimate_t const& rhs)
+		{
+			return covariance(lhs, rhs) / (lhs.stddev() * rhs.stddev());
+		}
+
+		friend tracked_estimate_t operator+(tracked_estimate_t const& lhs, tracked_estimate_t const& rhs)
+		{
+			return linear_combination(lhs.value() + rhs.value(), std::array{ &lhs, &rhs }, std::array<value_type, 2>{ 1, 1 });
+		}
+
+		friend tracked_estimate_t operator-(tracked_estimate_t const& lhs, tracked_estimate_t const& rhs)
+		{
+			return linear_combination(lhs.value() - rhs.value(), std::array{ &lhs, &rhs }, std::array<value_type, 2>{ 1, -1 });
+		}
+
+		friend tracked_estimate_t operator*(tracked_estimate_t const& lhs, tracked_estimate_t const& rhs)
+		{
+			return linear_combination(lhs.value() * rhs.value(), std::array{ &lhs, &rhs }, std::array<value_type, 2>{ rhs.value(), lhs.value() });
+		}
+
+		friend tracked_estimate_t operator/(tracked_estimate_t const& lhs, tracked_estimate_t const& rhs)
+		{
+			value_type inv_rhs = 1 / rhs.value(), quotient = lhs.value() * inv_rhs;
+			return linear_combination(quotient, std::array{ &lhs, &rhs }, std::array{ inv_rhs, -quotient * inv_rhs });
+		}
+
+		friend tracked_estimate_t operator-(tracked_estimate_t const& e)
+		{
+			return linear_combination(-e.value(), std::array{ &e }, std::array<value_type, 1>{ -1 });
+		}
+
+		// scaling by an exact value, also used by the mixed operators below
+		friend tracked_estimate_t scale(tracked_estimate_t const& e, value_type factor, value_type value)
+		{
+			return linear_combination(value, std::array{ &e }, std::array{ factor });
+		}
+	};
+
+	template<typename T>
+	tracked_estimate_t<T> uncertainty_context<T>::independent(std::string_view name, estimate_t<T> estimate)
+	{
+		auto source = source_id(_sources.size());
+		_sources.push_back({ std::string(name), estimate.variance() });
+
+		tracked_estimate_t<T> result(estimate.value());
+		result._context = this;
+		result._size = 1;
+		result._inline[0] = { source, 1 };
+		return result;
+	}
+
+	template<typename T>
+	inline constexpr bool is_tracked_estimate = false;
+
+	template<typename T>
+	inline constexpr bool is_tracked_estimate<tracked_estimate_t<T>> = true;
+
+
+	template<typename T, typename U> requires std::convertible_to<U, T>
+	tracked_estimate_t<T> operator+(tracked_estimate_t<T> const& e, U v)
+	{
+		return scale(e, T(1), e.value() + v);
+	}
+
+	template<typename T, typename U> requires std::convertible_to<U, T>
+	tracked_estimate_t<T> operator+(U v, tracked_estimate_t<T> const& e)
+	{
+		return e + v;
+	}
+
+	template<typename T, typename U> requires std::convertible_to<U, T>
+	tracked_estimate_t<T> operator-(tracked_estimate_t<T> const& e, U v)
+	{
+		return scale(e, T(1), e.value() - v);
+	}
+
+	template<typename T, typename U> requires std::convertible_to<U, T>
+	tracked_estimate_t<T> operator-(U v, tracked_estimate_t<T> const& e)
+	{
+		return scale(e, T(-1), v - e.value());
+	}
+
+	template<typename T, typename U> requires std::convertible_to<U, T>
+	tracked_estimate_t<T> operator*(tracked_estimate_t<T> const& e, U v)
+	{
+		return scale(e, T(v), e.value() * v);
+	}
+
+	template<typename T, typename U> requires std::convertible_to<U, T>
+	tracked_estimate_t<T> operator*(U v, tracked_estimate_t<T> const& e)
+	{
+		return e * v;
+	}
+
+	template<typename T, typename U> requires std::convertible_to<U, T>
+	tracked_estimate_t<T> operator/(tracked_estimate_t<T> const& e, U v)
+	{
+		return e * (T(1) / v);
+	}
+
+	template<typename T, typename U> requires std::convertible_to<U, T>
+	tracked_estimate_t<T> operator/(U v, tracked_estimate_t<T> const& e)
+	{
+		T quotient = v / e.value();
+		return scale(e, -quotient / e.value(), quotient);
+	}
+
+	// first order propagation through function.value_at/derivative_at, as lab::estimate,
+	// with the correlations between the arguments taken from their shared sources
+	template<typename T, size_t N>
+	tracked_estimate_t<T> estimate(auto const& function, std::array<tracked_estimate_t<T>, N> const& arguments)
+	{
+		auto [value, derivative] = [&]<size_t... In>(std::index_sequence<In...>)
+		{
+			return std::pair(function.value_at(arguments[In].value()...), function.derivative_at(arguments[In].value()...));
+		}(std::make_index_sequence<N>());
+
+		std::array<tracked_estimate_t<T> const*, N> pointers;
+		std::array<T, N> factors;
+		for (size_t i = 0; i != N; ++i)
+		{
+			pointers[i] = &arguments[i];
+			factors[i] = derivative[i];
+		}
+		return tracked_estimate_t<T>::linear_combination(value, pointers, factors);
+	}
+
+	// Sum of any number of weighted tracked estimates, such as the terms of a fit over a whole
+	// sample. Terms are collected unsorted and merged by source only when the buffer has doubled
+	// since the last merge and by result(), so a long sum costs O(terms log terms) and leaves a
+	// single sensitivity vector in the context arena instead of one per partial sum.
+	template<typename T = double>
+	class tracked_accumulator
+	{
+	public:
+		using value_type = T;
+		using estimate_type = tracked_estimate_t<value_type>;
+		using term_t = estimate_type::term_t;
+		static_assert(std::floating_point<value_type>);
+	private:
+		uncertainty_context<value_type>* _context = nullptr;
+		value_type _value = 0;
+		// merging does not change the sum, so result() may do it on a const accumulator
+		mutable std::vector<term_t> _terms;
+		mutable size_t _merged_size = 0;
+
+		void _merge() const
+		{
+			stdr::sort(_terms, {}, &term_t::source);
+			size_t size = 0;
+			for (size_t i = 0; i != _terms.size();)
+			{
+				term_t term = _terms[i];
+				for (++i; i != _terms.size() && _terms[i].source == term.source; ++i)
+					term.sensitivity += _terms[i].sensitivity;
+				if (term.sensitivity != 0)
+					_terms[size++] = term;
+			}
+			_terms.resize(size);
+			_merged_size = size;
+		}
+	public:
+		void add(estimate_type const& e, value_type factor = 1)
+		{
+			assert(_context == nullptr || e._context == nullptr || e._context == _context);
+			if (!_context)
+				_context = e._context;
+
+			_value += factor * e.value();
+			for (auto [source, sensitivity] : e.sensitivities())
+				_terms.push_back({ source, factor * sensitivity });
+			if (_terms.size() > 2 * _merged_size + 64)
+				_merge();
+		}
+
+		// exact term
+		void add(value_type value) { _value += value; }
+
+		value_type value() const { return _value; }
+
+		estimate_type result() const
+		{
+			_merge();
+			return estimate_type::_from_terms(_context, _value, _terms);
+		}
+	};
+
+	// row-major N x N covariance matrix of the given estimates
+	template<typename Range>
+	auto covariance_matrix(Range&& estimates)
+	{
+		static_assert(stdr::random_access_range<Range>);
+		static_assert(is_tracked_estimate<stdr::range_value_t<Range>>);
+
+		using value_type = stdr::range_value_t<Range>::value_type;
+
+		size_t size = stdr::size(estimates);
+		std::vector<value_type> matrix(size * size);
+		auto it = stdr::begin(estimates);
+		for (size_t i = 0; i != size; ++i)
+			for (size_t j = 0; j <= i; ++j)
+				matrix[i * size + j] = matrix[j * size + i] = covariance(it[i], it[j]);
+		return matrix;
+	}
+}
+
+export namespace std
+{
+	template<typename T, typename CharT>
+	struct formatter<lab::tracked_estimate_t<T>, CharT> : formatter<lab::estimate_t<T>, CharT>
+	{
+		template<typename FormatContext>
+		constexpr auto format(lab::tracked_estimate_t<T> const& estimate, FormatContext& format_context) const
+		{
+			return formatter<lab::estimate_t<T>, CharT>::format(estimate.to_estimate(), format_context);
+		}
+	};
+}
\ No newline at end of file